@@ -0,0 +1,106 @@
+// Compiles a corpus of scripts and counts the most common runs of opcodes
+// in the bytecode, to pick which sequences are worth fusing into one
+// instruction. PUSHC counts as one opcode, whatever constant it loads.
+// usage: OpcodeNgrams [--max N] [--top K] files...
+#include "CodeGenVisitor.h"
+#include "ConstantFolder.h"
+#include "Disassembler.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Peephole.h"
+#include "Program.h"
+#include "Resolver.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+// the opcodes of a script the way vlc would compile it, operands skipped
+auto compileOpcodes(const std::string &path) -> std::vector<std::uint8_t> {
+  auto source = SourceFile::fromPath(path);
+  if (source == nullptr) {
+    return {};
+  }
+  auto lexer = Lexer{source};
+  auto parser = Parser{lexer};
+  auto &ast = parser.parse();
+  ConstantFolder{ast}.run();
+  Resolver{ast}.run();
+  auto program = Program{};
+  auto codegen = CodeGen{program};
+  for (auto *statement : ast.Statements) {
+    codegen.visit(statement);
+  }
+  codegen.wrapUp();
+  Peephole{program, codegen.getConstants(), codegen.getLines()}.run();
+
+  auto opcodes = std::vector<std::uint8_t>{};
+  for (std::size_t at = 0; at < program.Bytecode.size(); ++at) {
+    opcodes.push_back(program.Bytecode[at]);
+    if (program.Bytecode[at] == PUSHC) {
+      at += 3; // 24 bit constant index
+    }
+  }
+  return opcodes;
+}
+} // namespace
+
+auto main(int argc, char *argv[]) -> int {
+  auto max_length = std::size_t{4};
+  auto top = std::size_t{20};
+  auto paths = std::vector<std::string>{};
+  for (auto i = 1; i < argc; ++i) {
+    auto arg = std::string_view{argv[i]};
+    if ((arg == "--max" || arg == "--top") && i + 1 < argc) {
+      auto value = std::string_view{argv[++i]};
+      std::from_chars(value.data(), value.data() + value.size(),
+                      arg == "--max" ? max_length : top);
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.empty()) {
+    std::cerr << "usage: OpcodeNgrams [--max N] [--top K] files...\n";
+    return 1;
+  }
+
+  // counts[n - 2] holds every run of n opcodes
+  auto counts = std::vector<std::map<std::vector<std::uint8_t>, std::size_t>>(
+      std::max<std::size_t>(max_length, 2) - 1);
+  auto total = std::size_t{0};
+  for (const auto &path : paths) {
+    auto opcodes = compileOpcodes(path);
+    total += opcodes.size();
+    for (std::size_t n = 2; n <= counts.size() + 1; ++n) {
+      for (std::size_t at = 0; at + n <= opcodes.size(); ++at) {
+        ++counts[n - 2][{opcodes.begin() + at, opcodes.begin() + at + n}];
+      }
+    }
+  }
+
+  std::cout << std::format("{} opcodes in {} files\n", total, paths.size());
+  for (std::size_t n = 2; n <= counts.size() + 1; ++n) {
+    auto ranked = std::vector<std::pair<std::vector<std::uint8_t>,
+                                        std::size_t>>(counts[n - 2].begin(),
+                                                      counts[n - 2].end());
+    std::ranges::sort(ranked, [](const auto &a, const auto &b) {
+      return a.second > b.second;
+    });
+    std::cout << std::format("\n{}-grams:\n", n);
+    for (std::size_t i = 0; i < std::min(top, ranked.size()); ++i) {
+      auto names = std::string{};
+      for (auto op : ranked[i].first) {
+        names += (names.empty() ? "" : " ") + opcodeName(op);
+      }
+      std::cout << std::format("{:>8} {:5.1f}%  {}\n", ranked[i].second,
+                               100.0 * ranked[i].second / total, names);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Parses a big generated script and reports the parse time, the time it
+// takes to free the AST and the peak RSS.
+// usage: ParseBench [statements]
+#include "Lexer.h"
+#include "Parser.h"
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+
+namespace {
+auto generateScript(std::size_t statements) -> std::string {
+  auto rng = std::mt19937{42};
+  auto pick = [&](std::size_t n) { return rng() % n; };
+  auto expression = [&] {
+    auto out = std::string{"x0"};
+    auto operators = std::string_view{"+-*/<"};
+    for (auto i = pick(12); i > 0; --i) {
+      out += std::format(" {} (x{} - {}.5)", operators[pick(5)], pick(10),
+                         pick(100));
+    }
+    return out;
+  };
+  auto src = std::string{};
+  for (auto i = 0; i < 10; ++i) {
+    src += std::format("x{}: Float -> {}.0;\n", i, i);
+  }
+  for (auto i = std::size_t{0}; i < statements; ++i) {
+    switch (pick(5)) {
+    case 0:
+      src += std::format("x{} -> {};\n", pick(10), expression());
+      break;
+    case 1:
+      src += std::format("print {};\n", expression());
+      break;
+    case 2:
+      src += std::format("if {} {{ x{} -> {}; }} else print \"no\";\n",
+                         expression(), pick(10), expression());
+      break;
+    case 3:
+      src += std::format("while x{} < 0.0 {{ y: Float -> {}; x{} -> y; }}\n",
+                         pick(10), expression(), pick(10));
+      break;
+    default:
+      src += std::format("{{ z: Float -> !{}; print z; }}\n", expression());
+      break;
+    }
+  }
+  return src;
+}
+
+auto peakRssKiB() -> long {
+  auto usage = rusage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  auto statements = argc > 1 ? std::stoul(argv[1]) : 200000;
+  auto source = SourceFile::fromString(generateScript(statements), "bench");
+  auto rss_before = peakRssKiB();
+  using Clock = std::chrono::steady_clock;
+  auto ms = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+
+  auto start = Clock::now();
+  auto lexer = Lexer{source};
+  auto parser = std::make_unique<Parser>(lexer);
+  auto &program = parser->parse();
+  auto parsed = Clock::now();
+  auto nodes = program.Statements.size();
+  parser.reset();
+  auto freed = Clock::now();
+
+  std::cout << std::format("source:    {} KiB, {} statements\n",
+                           source->getText().size() / 1024, nodes);
+  std::cout << std::format("parse:     {:.1f} ms\n", ms(parsed - start));
+  std::cout << std::format("free AST:  {:.1f} ms\n", ms(freed - parsed));
+  std::cout << std::format("peak RSS:  {} KiB ({} KiB before parsing)\n",
+                           peakRssKiB(), rss_before);
+
+  // the parser on its own, from tokens lexed up front
+  auto token_lexer = Lexer{source};
+  token_lexer.lex();
+  auto &tokens = token_lexer.getTokens();
+  auto parse_start = Clock::now();
+  auto token_parser = Parser{source, tokens};
+  token_parser.parse();
+  auto parse_time = Clock::now() - parse_start;
+  auto seconds = std::chrono::duration<double>(parse_time).count();
+  std::cout << std::format("parser:    {:.1f} ms, {:.1f}M tokens/s\n",
+                           ms(parse_time), tokens.size() / seconds / 1e6);
+}
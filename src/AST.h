@@ -1,32 +1,62 @@
 #ifndef AST_H
 #define AST_H
 
+#include "Arena.h"
+#include "Source.h"
 #include "Token.h"
-#include <memory>
+#include <cstdint>
 #include <optional>
+#include <span>
+#include <vector>
+
+// Every node carries its kind, visitExpression and visitStatement (bottom of
+// the file) switch on it to call the visitor's visit() for the concrete type.
+// No virtual calls, and the visit() overloads can be inlined into the walk.
+enum class ExpressionKind : std::uint8_t {
+  BinaryOperation,
+  LogicalOperation,
+  UnaryOperation,
+  Grouping,
+  Literal,
+  VariableEval,
+  InvalidExpression,
+};
 
-class NodeVisitor {
-public:
-  virtual auto visit(class Expression *node) -> void = 0;
-  virtual auto visit(class BinaryOperation *node) -> void = 0;
-  virtual auto visit(class UnaryOperation *node) -> void = 0;
-  virtual auto visit(class Grouping *node) -> void = 0;
-  virtual auto visit(class Literal *node) -> void = 0;
-  virtual auto visit(class InvalidExpression *node) -> void = 0;
-  virtual auto visit(class VariableEval *node) -> void = 0;
+enum class StatementKind : std::uint8_t {
+  InvalidStatement,
+  PrintStatement,
+  VariableDeclaration,
+  Assignment,
+  BlockScope,
+  IfStatement,
+  WhileStatement,
 };
 
 struct ASTNode {};
 
+// where a variable lives at runtime, filled in by the Resolver
+enum class SlotKind : std::uint8_t { Unresolved, Local, Global };
+struct Slot {
+  SlotKind Kind = SlotKind::Unresolved;
+  // stack offset of a local, or the resolver's number for a global
+  std::uint32_t Index = 0;
+};
+
+// what an expression is known to evaluate to, filled in by the TypeChecker
+enum class StaticType : std::uint8_t { Unknown, Float, Bool, String, Nil };
+
+// base for all kinds of expressions
 struct Expression {
-  std::size_t Line;
-  // base for all kinds of expressions
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  std::size_t Line = 0;
+  ExpressionKind Kind;
+  StaticType Type = StaticType::Unknown;
+
+protected:
+  explicit Expression(ExpressionKind kind) : Kind{kind} {}
 };
 
-using ExpressionPtr = std::unique_ptr<Expression>;
+// nodes live in the ProgramNode's arena, which frees them all at once
+using ExpressionPtr = Expression *;
 
 // Node for +, -, !=, etc.
 struct BinaryOperation : Expression {
@@ -34,12 +64,21 @@ struct BinaryOperation : Expression {
   ExpressionPtr Left;
   ExpressionPtr Right;
 
-  BinaryOperation(TokenType op, ExpressionPtr &lhs, ExpressionPtr &&rhs)
-      : Operator{op}, Left{std::move(lhs)}, Right{std::move(rhs)} {}
+  BinaryOperation(TokenType op, ExpressionPtr lhs, ExpressionPtr rhs)
+      : Expression{ExpressionKind::BinaryOperation}, Operator{op}, Left{lhs},
+        Right{rhs} {}
+};
 
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+// Node for && and ||. The right side only runs when the left side doesn't
+// already decide the result, which is always a Bool.
+struct LogicalOperation : Expression {
+  TokenType Operator;
+  ExpressionPtr Left;
+  ExpressionPtr Right;
+
+  LogicalOperation(TokenType op, ExpressionPtr lhs, ExpressionPtr rhs)
+      : Expression{ExpressionKind::LogicalOperation}, Operator{op}, Left{lhs},
+        Right{rhs} {}
 };
 
 // Node for -x, !x, etc.
@@ -47,133 +86,179 @@ struct UnaryOperation : Expression {
   TokenType Operator;
   ExpressionPtr Right;
 
-  UnaryOperation(TokenType op, ExpressionPtr &&rhs)
-      : Operator{op}, Right{std::move(rhs)} {}
-
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  UnaryOperation(TokenType op, ExpressionPtr rhs)
+      : Expression{ExpressionKind::UnaryOperation}, Operator{op}, Right{rhs} {}
 };
 
 // Node for (x)
 struct Grouping : Expression {
   ExpressionPtr Expr;
 
-  Grouping(ExpressionPtr &&expr) : Expr{std::move(expr)} {}
-
-  auto acceptVisitor(NodeVisitor *visitor) -> void override {
-    visitor->visit(this);
-  }
+  Grouping(ExpressionPtr expr)
+      : Expression{ExpressionKind::Grouping}, Expr{expr} {}
 };
 
 // Node for raw bools, doubles, and strings.
 struct Literal : Expression {
   LiteralVariant Value;
 
-  Literal(const LiteralVariant &value) : Value{value} {}
-
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  Literal(const LiteralVariant &value)
+      : Expression{ExpressionKind::Literal}, Value{value} {}
 };
 
 struct VariableEval : Expression {
-  std::string Name;
-
-  VariableEval(const std::string &name) : Name{name} {}
+  std::string_view Name;
+  Slot Target;
 
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  VariableEval(std::string_view name)
+      : Expression{ExpressionKind::VariableEval}, Name{name} {}
 };
 
 struct InvalidExpression : Expression {
-  virtual auto acceptVisitor(class NodeVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
-};
-
-class StatementVisitor {
-public:
-  virtual auto visit(class Statement *statement) -> void = 0;
-  virtual auto visit(class InvalidStatement *statement) -> void = 0;
-  virtual auto visit(class PrintStatement *statement) -> void = 0;
-  virtual auto visit(class VariableDeclaration *statement) -> void = 0;
-  virtual auto visit(class Assignment *assignment) -> void = 0;
-  virtual auto visit(class BlockScope *block_scope) -> void = 0;
-  virtual auto visit(class IfStatement *if_statement) -> void = 0;
-  virtual auto visit(class WhileStatement *while_statement) -> void = 0;
+  InvalidExpression() : Expression{ExpressionKind::InvalidExpression} {}
 };
 
 // *STATEMENTS ARE INDIVIDUAL UNITS OF EXECUTION*
 struct Statement {
-  std::size_t Line;
+  std::size_t Line = 0;
+  StatementKind Kind;
 
-  virtual ~Statement() {}
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void = 0;
+protected:
+  explicit Statement(StatementKind kind) : Kind{kind} {}
 };
-using StatementPtr = std::unique_ptr<Statement>;
+using StatementPtr = Statement *;
 
 // representing statements that *SOMEONE* messed up
 struct InvalidStatement : Statement {
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  InvalidStatement() : Statement{StatementKind::InvalidStatement} {}
 };
 
 struct PrintStatement : Statement {
   ExpressionPtr Expr;
 
-  PrintStatement(ExpressionPtr &&expr) : Expr(std::move(expr)) {}
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  PrintStatement(ExpressionPtr expr)
+      : Statement{StatementKind::PrintStatement}, Expr(expr) {}
 };
 
 struct VariableDeclaration : Statement {
-  std::string Type;
-  std::string Name;
-  ExpressionPtr AssignedValue;
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  std::string_view Type;
+  std::string_view Name;
+  ExpressionPtr AssignedValue = nullptr;
+  Slot Target;
+
+  VariableDeclaration() : Statement{StatementKind::VariableDeclaration} {}
 };
 
 struct Assignment : Statement {
-  std::string Name;
-  ExpressionPtr AssignmentValue;
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  std::string_view Name;
+  ExpressionPtr AssignmentValue = nullptr;
+  Slot Target;
+
+  Assignment() : Statement{StatementKind::Assignment} {}
 };
 
 struct BlockScope : Statement {
-  std::vector<std::unique_ptr<Statement>> Statements;
+  // the array lives in the arena as well
+  std::span<StatementPtr> Statements;
   std::size_t ScopeDepth = 0;
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  // locals declared directly in this block, popped when it ends
+  std::size_t LocalCount = 0;
+
+  BlockScope() : Statement{StatementKind::BlockScope} {}
 };
 
 struct IfStatement : Statement {
-  StatementPtr IfBody;
+  StatementPtr IfBody = nullptr;
   std::optional<StatementPtr> ElseBody;
-  ExpressionPtr Condition;
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  ExpressionPtr Condition = nullptr;
+
+  IfStatement() : Statement{StatementKind::IfStatement} {}
 };
 
 struct WhileStatement : Statement {
-  StatementPtr Body;
-  ExpressionPtr Condition;
-  virtual auto acceptVisitor(class StatementVisitor *visitor) -> void {
-    visitor->visit(this);
-  }
+  StatementPtr Body = nullptr;
+  ExpressionPtr Condition = nullptr;
+
+  WhileStatement() : Statement{StatementKind::WhileStatement} {}
 };
 
 struct ProgramNode {
+  // names in the tree are views into this, so the program keeps it alive
+  SourcePtr Source;
+  // owns the strings of the Literal nodes
+  InternerPtr Strings;
+  // owns every node (and name, if there is no Source) of the tree
+  Arena Nodes;
   std::vector<StatementPtr> Statements;
 };
 
+// True if statement declares something outside of any block of its own, like
+// `if c x: Float -> 1;`. That declaration belongs to the enclosing scope,
+// whether it runs or not, so passes that drop or wrap the statement have to
+// leave it where it is.
+inline auto declaresOutsideBlock(const Statement *statement) -> bool {
+  if (statement == nullptr) {
+    return false;
+  }
+  switch (statement->Kind) {
+  case StatementKind::VariableDeclaration:
+    return true;
+  case StatementKind::IfStatement: {
+    const auto *branch = static_cast<const IfStatement *>(statement);
+    return declaresOutsideBlock(branch->IfBody) ||
+           (branch->ElseBody.has_value() &&
+            declaresOutsideBlock(*branch->ElseBody));
+  }
+  case StatementKind::WhileStatement:
+    return declaresOutsideBlock(
+        static_cast<const WhileStatement *>(statement)->Body);
+  default:
+    return false;
+  }
+}
+
+// calls visitor.visit() with node cast to its concrete type
+template <typename Visitor>
+auto visitExpression(Visitor &&visitor, Expression *node) -> decltype(auto) {
+  switch (node->Kind) {
+  case ExpressionKind::BinaryOperation:
+    return visitor.visit(static_cast<BinaryOperation *>(node));
+  case ExpressionKind::LogicalOperation:
+    return visitor.visit(static_cast<LogicalOperation *>(node));
+  case ExpressionKind::UnaryOperation:
+    return visitor.visit(static_cast<UnaryOperation *>(node));
+  case ExpressionKind::Grouping:
+    return visitor.visit(static_cast<Grouping *>(node));
+  case ExpressionKind::Literal:
+    return visitor.visit(static_cast<Literal *>(node));
+  case ExpressionKind::VariableEval:
+    return visitor.visit(static_cast<VariableEval *>(node));
+  case ExpressionKind::InvalidExpression:
+    break;
+  }
+  return visitor.visit(static_cast<InvalidExpression *>(node));
+}
+
+template <typename Visitor>
+auto visitStatement(Visitor &&visitor, Statement *statement)
+    -> decltype(auto) {
+  switch (statement->Kind) {
+  case StatementKind::PrintStatement:
+    return visitor.visit(static_cast<PrintStatement *>(statement));
+  case StatementKind::VariableDeclaration:
+    return visitor.visit(static_cast<VariableDeclaration *>(statement));
+  case StatementKind::Assignment:
+    return visitor.visit(static_cast<Assignment *>(statement));
+  case StatementKind::BlockScope:
+    return visitor.visit(static_cast<BlockScope *>(statement));
+  case StatementKind::IfStatement:
+    return visitor.visit(static_cast<IfStatement *>(statement));
+  case StatementKind::WhileStatement:
+    return visitor.visit(static_cast<WhileStatement *>(statement));
+  case StatementKind::InvalidStatement:
+    break;
+  }
+  return visitor.visit(static_cast<InvalidStatement *>(statement));
+}
+
 #endif // !AST_H
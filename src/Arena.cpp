@@ -0,0 +1,30 @@
+#include "Arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+auto Arena::allocate(std::size_t size, std::size_t align) -> void * {
+  auto padding = -reinterpret_cast<std::uintptr_t>(next_) & (align - 1);
+  if (next_ == nullptr || padding + size > remaining_) {
+    // anything too big for a block gets a block of its own
+    auto block_size = std::max(BlockSize, size + align);
+    blocks_.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+    next_ = blocks_.back().get();
+    remaining_ = block_size;
+    padding = -reinterpret_cast<std::uintptr_t>(next_) & (align - 1);
+  }
+  auto *out = next_ + padding;
+  next_ += padding + size;
+  remaining_ -= padding + size;
+  bytes_used_ += size;
+  return out;
+}
+
+auto Arena::copyString(std::string_view text) -> std::string_view {
+  if (text.empty()) {
+    return {};
+  }
+  auto *out = static_cast<char *>(allocate(text.size(), 1));
+  std::memcpy(out, text.data(), text.size());
+  return {out, text.size()};
+}
@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for things that all die at the same time (the AST). Objects
+// are never destroyed one by one, dropping the arena just frees its blocks, so
+// only trivially destructible types can live in here.
+class Arena {
+public:
+  static constexpr auto BlockSize = std::size_t{64 * 1024};
+
+  Arena() = default;
+  Arena(Arena &&) = default;
+  auto operator=(Arena &&) -> Arena & = default;
+
+  auto allocate(std::size_t size, std::size_t align) -> void *;
+
+  template <typename T, typename... Args> auto make(Args &&...args) -> T * {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "the arena never runs destructors");
+    return new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+  template <typename T>
+  auto copyArray(std::span<const T> items) -> std::span<T> {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (items.empty()) {
+      return {};
+    }
+    auto *out = static_cast<T *>(allocate(items.size_bytes(), alignof(T)));
+    std::uninitialized_copy(items.begin(), items.end(), out);
+    return {out, items.size()};
+  }
+  auto copyString(std::string_view text) -> std::string_view;
+
+  // bytes handed out so far (not counting padding or unused block space)
+  auto getBytesUsed() const -> std::size_t { return bytes_used_; }
+
+private:
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte *next_ = nullptr;
+  std::size_t remaining_ = 0;
+  std::size_t bytes_used_ = 0;
+};
+
+#endif // !ARENA_H
@@ -0,0 +1,67 @@
+#include "Assembler.h"
+#include "Error.h"
+#include "Util.h"
+#include <algorithm>
+
+Assembler::Assembler(Program &program, ConstantPool &constants)
+    : program_{program}, constants_{constants} {}
+
+auto Assembler::emit(std::uint8_t byte, std::size_t line) -> std::size_t {
+  program_.Bytecode.push_back(byte);
+  lines_.append(line);
+  return program_.Bytecode.size() - 1;
+}
+
+auto Assembler::newLabel() -> Label {
+  labels_.emplace_back();
+  return Label{labels_.size() - 1};
+}
+
+auto Assembler::bind(Label label) -> void {
+  auto offset = program_.Bytecode.size();
+  labels_[label.Index] = offset;
+  // fill in every jump that got here first
+  std::erase_if(fixups_, [&](const Fixup &fixup) {
+    if (fixup.Target.Index != label.Index) {
+      return false;
+    }
+    patch(fixup.Operand, offset);
+    return true;
+  });
+}
+
+auto Assembler::emitJump(std::uint8_t op, Label label, std::size_t line)
+    -> void {
+  emit(PUSHC, line);
+  auto operand = emit(0, line);
+  emit(0, line);
+  emit(0, line);
+  emit(op, line);
+  if (auto offset = labels_[label.Index]; offset.has_value()) {
+    patch(operand, *offset); // a backward jump
+  } else {
+    fixups_.push_back({label, operand});
+  }
+}
+
+auto Assembler::emitConstant(int index, std::size_t line) -> void {
+  // ran out of space for all the constants
+  if (index == -1) {
+    reportError("Could not enough space for all program constants. Program "
+                "is too large.");
+  }
+  auto indices = sizeToTriByte(index);
+  emit(PUSHC, line);
+  emit(std::get<0>(indices), line);
+  emit(std::get<1>(indices), line);
+  emit(std::get<2>(indices), line);
+}
+
+auto Assembler::patch(std::size_t operand, std::size_t offset) -> void {
+  auto index = constants_.addDouble(static_cast<double>(offset));
+  auto indices = sizeToTriByte(index);
+  auto &bytes = program_.Bytecode;
+  bytes[operand] = std::get<0>(indices);
+  bytes[operand + 1] = std::get<1>(indices);
+  bytes[operand + 2] = std::get<2>(indices);
+}
@@ -0,0 +1,60 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include "ConstantPool.h"
+#include "LineTable.h"
+#include "Program.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// A place in the bytecode that jumps can go to before it has been reached.
+struct Label {
+  std::size_t Index;
+};
+
+// Writes the bytes of a Program, keeping their source lines in a LineTable
+// (Program::Lines stays empty). A jump is
+// PUSHC <target offset> JMP_TO / JMP_TO_IF_FALSE. A jump to a label that isn't
+// bound yet is patched when bind() reaches it, so nobody has to work out
+// offsets by hand.
+//
+// The target always goes through the constant table, so every jump is the
+// same 5 bytes and there is no shorter form to relax to. Relative rel8/16/32
+// jumps need the VM to decode them.
+class Assembler {
+public:
+  Assembler(Program &program, ConstantPool &constants);
+
+  // appends one byte and returns its offset
+  auto emit(std::uint8_t byte, std::size_t line) -> std::size_t;
+  auto newLabel() -> Label;
+  // the label is the next byte written
+  auto bind(Label label) -> void;
+  auto emitJump(std::uint8_t op, Label label, std::size_t line) -> void;
+  // PUSHC <index>
+  auto emitConstant(int index, std::size_t line) -> void;
+  // jumps whose label was never bound
+  auto getUnresolvedCount() const -> std::size_t { return fixups_.size(); }
+  auto getLines() -> LineTable & { return lines_; }
+
+private:
+  // writes the constant for offset into the 3 operand bytes at operand
+  auto patch(std::size_t operand, std::size_t offset) -> void;
+
+private:
+  struct Fixup {
+    Label Target;
+    // first byte of the PUSHC operand
+    std::size_t Operand;
+  };
+
+  Program &program_;
+  ConstantPool &constants_;
+  LineTable lines_;
+  std::vector<std::optional<std::size_t>> labels_;
+  std::vector<Fixup> fixups_;
+};
+
+#endif // !ASSEMBLER_H
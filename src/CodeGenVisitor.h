@@ -1,37 +1,61 @@
 #include "AST.h"
+#include "Assembler.h"
+#include "ConstantPool.h"
 #include "Program.h"
 #include <cstddef>
-#include <stack>
+#include <cstdint>
+#include <vector>
 
-struct Local {
-  std::size_t Depth;
-  std::string Name;
-};
-
-class CodeGen : public StatementVisitor, public NodeVisitor {
+// Expects a program the Resolver has run over, every variable is already
+// bound to a slot.
+class CodeGen {
 public:
   explicit CodeGen(Program &program);
-  auto visit(Statement *statement) -> void override;
-  auto visit(VariableDeclaration *statement) -> void override;
-  auto visit(PrintStatement *statement) -> void override;
-  auto visit(InvalidStatement *statement) -> void override;
-  auto visit(Assignment *statement) -> void override;
-  auto visit(BlockScope *statement) -> void override;
+  // dispatch on the node's kind to one of the overloads below
+  auto visit(Statement *statement) -> void { visitStatement(*this, statement); }
+  auto visit(Expression *node) -> void { visitExpression(*this, node); }
+
+  auto visit(VariableDeclaration *statement) -> void;
+  auto visit(PrintStatement *statement) -> void;
+  auto visit(InvalidStatement *statement) -> void;
+  auto visit(Assignment *statement) -> void;
+  auto visit(BlockScope *statement) -> void;
+  auto visit(IfStatement *node) -> void;
+  auto visit(WhileStatement *node) -> void;
+
+  auto visit(BinaryOperation *node) -> void;
+  auto visit(LogicalOperation *node) -> void;
+  auto visit(UnaryOperation *node) -> void;
+  auto visit(Grouping *node) -> void;
+  auto visit(Literal *node) -> void;
+  auto visit(InvalidExpression *node) -> void;
+  auto visit(VariableEval *node) -> void;
 
-  auto visit(Expression *node) -> void override;
-  auto visit(BinaryOperation *node) -> void override;
-  auto visit(UnaryOperation *node) -> void override;
-  auto visit(Grouping *node) -> void override;
-  auto visit(Literal *node) -> void override;
-  auto visit(InvalidExpression *node) -> void override;
-  auto visit(VariableEval *node) -> void override;
-  auto visit(IfStatement *node) -> void override;
-  auto visit(WhileStatement *node) -> void override;
+  // ends the program with a HALT
+  auto wrapUp() -> void { assembler_.emit(HALT, 0); }
+  auto getConstants() -> ConstantPool & { return constants_; }
+  // the source line of every byte written so far
+  auto getLines() -> LineTable & { return assembler_.getLines(); }
+
+private:
+  // Control flow for a condition, nothing is left on the stack: falls through
+  // when it holds and jumps to label when it doesn't (or the other way
+  // around). && and || become jumps instead of pushing a Bool.
+  auto emitBranchIfFalse(Expression *condition, Label label, std::size_t line)
+      -> void;
+  auto emitBranchIfTrue(Expression *condition, Label label, std::size_t line)
+      -> void;
+  // Pushes index (a local's stack offset, a global's index) for op to pop:
+  // PUSHC <constant> op. The VM has no inline operands yet, this is the one
+  // place to change when it does.
+  auto emitIndexed(std::uint8_t op, std::size_t index, std::size_t line)
+      -> void;
 
 private:
-  std::size_t current_scope_depth_ = 0;
   Program &program_;
-  std::vector<Local> local_table_;
+  // the Program's index of each global, by the resolver's number
+  std::vector<std::size_t> global_slots_;
+  // every distinct number and string becomes a single constant
+  ConstantPool constants_;
+  Assembler assembler_;
 };
-
-inline auto wrapUp(Program &program) -> void { program.pushCode(HALT, 0); }
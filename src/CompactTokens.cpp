@@ -0,0 +1,191 @@
+#include "CompactTokens.h"
+#include <algorithm>
+#include <cassert>
+#include <format>
+
+static_assert(static_cast<std::size_t>(TokenType::INVALID) <= UINT8_MAX,
+              "token types have to fit in a byte");
+
+CompactTokens::CompactTokens(SourcePtr source, InternerPtr strings)
+    : source_{std::move(source)}, strings_{std::move(strings)} {}
+
+auto CompactTokens::fromLexer(Lexer &lexer) -> CompactTokens {
+  auto tokens = CompactTokens{lexer.getSource(), lexer.getInterner()};
+  if (!lexer.getTokens().empty()) {
+    for (const auto &token : lexer.getTokens()) {
+      tokens.push(token);
+    }
+    return tokens;
+  }
+  auto token = Token{};
+  do {
+    token = lexer.next();
+    tokens.push(token);
+  } while (token.Type != TokenType::END_OF_FILE);
+  return tokens;
+}
+
+auto CompactTokens::push(const Token &token) -> void {
+  assert(source_->getText().size() <= UINT32_MAX &&
+         "source too large for 32 bit offsets");
+  types_.push_back(static_cast<std::uint8_t>(token.Type));
+  offsets_.push_back(static_cast<std::uint32_t>(offsetOf(token)));
+  lengths_.push_back(static_cast<std::uint32_t>(token.Lexeme.size()));
+  lines_.push_back(static_cast<std::uint32_t>(token.Line));
+  if (LiteralVariantType{token.Value.index()} != LiteralVariantType::NIL) {
+    literal_tokens_.push_back(static_cast<std::uint32_t>(types_.size() - 1));
+    literal_values_.push_back(token.Value);
+  }
+}
+
+auto CompactTokens::applyEdit(const TextEdit &edit) -> void {
+  // the lexer peeks at most this far past the end of a token (the "e+" of a
+  // number without exponent digits)
+  constexpr auto lookahead = std::size_t{2};
+  assert(edit.Offset + edit.RemovedLength <= source_->getText().size() &&
+         "edit past the end of the file");
+  source_ = source_->withEdit(edit);
+  auto delta = static_cast<std::int64_t>(edit.Inserted.size()) -
+               static_cast<std::int64_t>(edit.RemovedLength);
+  // in the old text, nothing from here on changed
+  auto edit_end = edit.Offset + edit.RemovedLength;
+
+  // first token that could have seen the edit, everything before it stays
+  auto first = std::size_t{0};
+  auto count = size();
+  while (count > 0) {
+    auto half = count / 2;
+    auto mid = first + half;
+    if (offsets_[mid] + lengths_[mid] + lookahead < edit.Offset) {
+      first = mid + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  auto lexer = Lexer{source_, strings_};
+  if (first > 0) {
+    // string tokens carry the line they end on, which is right for resuming
+    lexer.resumeAt(offsets_[first - 1] + lengths_[first - 1],
+                   lines_[first - 1]);
+  }
+
+  // re-lex until a new token starts where an old one behind the edit did,
+  // the lexer is in the same state there so the rest would come out the same
+  auto fresh = CompactTokens{source_, strings_};
+  auto last = first;
+  auto line_delta = std::int64_t{0};
+  while (true) {
+    auto token = lexer.next();
+    auto offset = static_cast<std::int64_t>(offsetOf(token));
+    while (last < size() && offsets_[last] + delta < offset) {
+      ++last;
+    }
+    if (last < size() && offsets_[last] >= edit_end &&
+        offsets_[last] + delta == offset) {
+      line_delta = static_cast<std::int64_t>(token.Line) - lines_[last];
+      break;
+    }
+    fresh.push(token);
+    if (token.Type == TokenType::END_OF_FILE) {
+      // only if the old stream had no END_OF_FILE to line up with
+      last = size();
+      break;
+    }
+  }
+
+  // splice the new tokens in for old ones in [first, last)
+  auto replace = [&](auto &array, const auto &with) {
+    array.erase(array.begin() + first, array.begin() + last);
+    array.insert(array.begin() + first, with.begin(), with.end());
+  };
+  replace(types_, fresh.types_);
+  replace(offsets_, fresh.offsets_);
+  replace(lengths_, fresh.lengths_);
+  replace(lines_, fresh.lines_);
+  for (auto i = first + fresh.size(); i < size(); ++i) {
+    offsets_[i] = static_cast<std::uint32_t>(offsets_[i] + delta);
+    lines_[i] = static_cast<std::uint32_t>(lines_[i] + line_delta);
+  }
+
+  auto literal_first =
+      std::lower_bound(literal_tokens_.begin(), literal_tokens_.end(), first) -
+      literal_tokens_.begin();
+  auto literal_last =
+      std::lower_bound(literal_tokens_.begin(), literal_tokens_.end(), last) -
+      literal_tokens_.begin();
+  auto index_delta = static_cast<std::int64_t>(fresh.size()) -
+                     static_cast<std::int64_t>(last - first);
+  for (auto i = literal_last; i < std::ssize(literal_tokens_); ++i) {
+    literal_tokens_[i] =
+        static_cast<std::uint32_t>(literal_tokens_[i] + index_delta);
+  }
+  for (auto &index : fresh.literal_tokens_) {
+    index += first;
+  }
+  literal_tokens_.erase(literal_tokens_.begin() + literal_first,
+                        literal_tokens_.begin() + literal_last);
+  literal_tokens_.insert(literal_tokens_.begin() + literal_first,
+                         fresh.literal_tokens_.begin(),
+                         fresh.literal_tokens_.end());
+  literal_values_.erase(literal_values_.begin() + literal_first,
+                        literal_values_.begin() + literal_last);
+  literal_values_.insert(literal_values_.begin() + literal_first,
+                         fresh.literal_values_.begin(),
+                         fresh.literal_values_.end());
+}
+
+auto CompactTokens::offsetOf(const Token &token) const -> std::size_t {
+  auto text = source_->getText();
+  // tokens that didn't come from the source (END_OF_FILE) sit at the end
+  if (token.Lexeme.data() == nullptr) {
+    return text.size();
+  }
+  return static_cast<std::size_t>(token.Lexeme.data() - text.data());
+}
+
+auto CompactTokens::getLexeme(std::size_t i) const -> std::string_view {
+  return source_->getText().substr(offsets_[i], lengths_[i]);
+}
+
+auto CompactTokens::getValue(std::size_t i) const -> LiteralVariant {
+  auto it =
+      std::lower_bound(literal_tokens_.begin(), literal_tokens_.end(), i);
+  if (it == literal_tokens_.end() || *it != i) {
+    return None{};
+  }
+  return literal_values_[it - literal_tokens_.begin()];
+}
+
+auto CompactTokens::getToken(std::size_t i) const -> Token {
+  return Token{.Lexeme = getLexeme(i),
+               .Line = getLine(i),
+               .Value = getValue(i),
+               .Type = getType(i)};
+}
+
+auto CompactTokens::getMemoryUsage() const -> std::size_t {
+  return types_.capacity() * sizeof(std::uint8_t) +
+         offsets_.capacity() * sizeof(std::uint32_t) +
+         lengths_.capacity() * sizeof(std::uint32_t) +
+         lines_.capacity() * sizeof(std::uint32_t) +
+         literal_tokens_.capacity() * sizeof(std::uint32_t) +
+         literal_values_.capacity() * sizeof(LiteralVariant);
+}
+
+auto printTokenMemoryReport(std::ostream &stream, const CompactTokens &tokens)
+    -> void {
+  auto count = tokens.size();
+  // a vector<Token> holding the same tokens (string literals live in the
+  // interner either way)
+  auto token_bytes = count * sizeof(Token);
+  auto compact_bytes = tokens.getMemoryUsage();
+  auto per_token = [&](std::size_t bytes) {
+    return count == 0 ? 0.0 : static_cast<double>(bytes) / count;
+  };
+  stream << std::format("tokens: {}\n", count);
+  stream << std::format("vector<Token>: {} bytes ({:.1f} per token)\n",
+                        token_bytes, per_token(token_bytes));
+  stream << std::format("compact:       {} bytes ({:.1f} per token)\n",
+                        compact_bytes, per_token(compact_bytes));
+}
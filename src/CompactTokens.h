@@ -0,0 +1,63 @@
+#ifndef COMPACT_TOKENS_H
+#define COMPACT_TOKENS_H
+
+#include "Lexer.h"
+#include "Source.h"
+#include "Token.h"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// A token stream stored as parallel arrays instead of a vector<Token>. The
+// parser mostly asks "what type is the next token", which only touches the
+// 1 byte type array; lexemes are rebuilt from offsets into the source and the
+// few tokens that carry a literal value keep it in a side table.
+// Offsets are 32 bit, so a single source file is limited to 4 GiB.
+class CompactTokens {
+public:
+  explicit CompactTokens(SourcePtr source, InternerPtr strings);
+  // drains the lexer with next()
+  static auto fromLexer(Lexer &lexer) -> CompactTokens;
+
+  auto push(const Token &token) -> void;
+  // Moves the stream over to the edited source. Only the tokens around the
+  // edit are lexed again (until the new tokens line up with the old ones),
+  // the rest just get their offsets and lines shifted. Lexer errors are only
+  // reported for the re-lexed part.
+  auto applyEdit(const TextEdit &edit) -> void;
+
+  auto size() const -> std::size_t { return types_.size(); }
+  auto getType(std::size_t i) const -> TokenType {
+    return static_cast<TokenType>(types_[i]);
+  }
+  auto getLexeme(std::size_t i) const -> std::string_view;
+  auto getLine(std::size_t i) const -> std::size_t { return lines_[i]; }
+  auto getValue(std::size_t i) const -> LiteralVariant;
+  // rebuilds the full token
+  auto getToken(std::size_t i) const -> Token;
+  auto getSource() const -> const SourcePtr & { return source_; }
+  auto getInterner() const -> const InternerPtr & { return strings_; }
+  // bytes held by the arrays (capacity, not size)
+  auto getMemoryUsage() const -> std::size_t;
+
+private:
+  // where the token starts in source_
+  auto offsetOf(const Token &token) const -> std::size_t;
+
+private:
+  SourcePtr source_;
+  InternerPtr strings_;
+  std::vector<std::uint8_t> types_;
+  std::vector<std::uint32_t> offsets_;
+  std::vector<std::uint32_t> lengths_;
+  std::vector<std::uint32_t> lines_;
+  // literal payloads, literal_tokens_ is sorted by token index
+  std::vector<std::uint32_t> literal_tokens_;
+  std::vector<LiteralVariant> literal_values_;
+};
+
+// what the same tokens would cost as a vector<Token> vs the compact arrays
+auto printTokenMemoryReport(std::ostream &stream, const CompactTokens &tokens)
+    -> void;
+
+#endif // !COMPACT_TOKENS_H
@@ -0,0 +1,446 @@
+#include "ConstantFolder.h"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+auto asLiteral(ExpressionPtr node) -> Literal * {
+  if (node->Kind != ExpressionKind::Literal) {
+    return nullptr;
+  }
+  return static_cast<Literal *>(node);
+}
+
+auto asDouble(ExpressionPtr node) -> const double * {
+  auto *literal = asLiteral(node);
+  return literal == nullptr ? nullptr : std::get_if<double>(&literal->Value);
+}
+
+// Only true and false count as constant conditions. What JMP_TO_IF_FALSE does
+// with nil or a number is up to the VM.
+auto asBool(ExpressionPtr node) -> const bool * {
+  auto *literal = asLiteral(node);
+  return literal == nullptr ? nullptr : std::get_if<bool>(&literal->Value);
+}
+
+// nodes in a (folded) subtree, for the removed node count
+struct NodeCounter {
+  std::size_t Count = 0;
+
+  auto visit(Statement *statement) -> void {
+    ++Count;
+    visitStatement(*this, statement);
+  }
+  auto visit(Expression *node) -> void {
+    ++Count;
+    visitExpression(*this, node);
+  }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void { visit(statement->Expr); }
+  auto visit(VariableDeclaration *statement) -> void {
+    visit(statement->AssignedValue);
+  }
+  auto visit(Assignment *statement) -> void {
+    visit(statement->AssignmentValue);
+  }
+  auto visit(BlockScope *statement) -> void {
+    for (auto *child : statement->Statements) {
+      visit(child);
+    }
+  }
+  auto visit(IfStatement *statement) -> void {
+    visit(statement->Condition);
+    visit(statement->IfBody);
+    if (statement->ElseBody.has_value()) {
+      visit(*statement->ElseBody);
+    }
+  }
+  auto visit(WhileStatement *statement) -> void {
+    visit(statement->Condition);
+    visit(statement->Body);
+  }
+  auto visit(BinaryOperation *node) -> void {
+    visit(node->Left);
+    visit(node->Right);
+  }
+  auto visit(LogicalOperation *node) -> void {
+    visit(node->Left);
+    visit(node->Right);
+  }
+  auto visit(UnaryOperation *node) -> void { visit(node->Right); }
+  auto visit(Grouping *node) -> void { visit(node->Expr); }
+  auto visit(Literal *node) -> void {}
+  auto visit(VariableEval *node) -> void {}
+  auto visit(InvalidExpression *node) -> void {}
+};
+
+auto countNodes(StatementPtr statement) -> std::size_t {
+  if (statement == nullptr) {
+    return 0;
+  }
+  auto counter = NodeCounter{};
+  counter.visit(statement);
+  return counter.Count;
+}
+
+auto countNodes(ExpressionPtr node) -> std::size_t {
+  auto counter = NodeCounter{};
+  counter.visit(node);
+  return counter.Count;
+}
+
+// the value the VM would compute for lhs op rhs, if it is safe to compute it
+// here
+auto foldBinary(TokenType op, const LiteralVariant &lhs,
+                const LiteralVariant &rhs, StringInterner *strings)
+    -> std::optional<LiteralVariant> {
+  const auto *a = std::get_if<double>(&lhs);
+  const auto *b = std::get_if<double>(&rhs);
+  if (a != nullptr && b != nullptr) {
+    switch (op) {
+    case TokenType::PLUS:
+      return LiteralVariant{*a + *b};
+    case TokenType::MINUS:
+      return LiteralVariant{*a - *b};
+    case TokenType::MUL:
+      return LiteralVariant{*a * *b};
+    case TokenType::DIV:
+      // leave dividing by zero to the VM
+      if (*b == 0) {
+        return std::nullopt;
+      }
+      return LiteralVariant{*a / *b};
+    case TokenType::EQUALITY:
+      return LiteralVariant{*a == *b};
+    case TokenType::INEQUALITY:
+      return LiteralVariant{*a != *b};
+    case TokenType::LESS_THAN:
+      return LiteralVariant{*a < *b};
+    case TokenType::LESS_THAN_OR_EQUAL:
+      return LiteralVariant{*a <= *b};
+    case TokenType::GREATER_THAN:
+      return LiteralVariant{*a > *b};
+    case TokenType::GREATER_THAN_OR_EQUAL:
+      return LiteralVariant{*a >= *b};
+    default:
+      return std::nullopt;
+    }
+  }
+  const auto *p = std::get_if<bool>(&lhs);
+  const auto *q = std::get_if<bool>(&rhs);
+  if (p != nullptr && q != nullptr) {
+    if (op == TokenType::EQUALITY) {
+      return LiteralVariant{*p == *q};
+    }
+    if (op == TokenType::INEQUALITY) {
+      return LiteralVariant{*p != *q};
+    }
+    return std::nullopt;
+  }
+  // strings only get concatenated, whether = compares them by identity or by
+  // contents is up to the VM
+  const auto *s = std::get_if<InternedString>(&lhs);
+  const auto *t = std::get_if<InternedString>(&rhs);
+  if (s != nullptr && t != nullptr && op == TokenType::PLUS &&
+      strings != nullptr) {
+    auto text = std::string{s->view()};
+    text += t->view();
+    return LiteralVariant{strings->intern(text)};
+  }
+  return std::nullopt;
+}
+} // namespace
+
+ConstantFolder::ConstantFolder(ProgramNode &program) : program_{program} {}
+
+auto ConstantFolder::run() -> void {
+  findFloatVariables();
+  std::erase_if(program_.Statements, [&](StatementPtr &statement) {
+    statement = visit(statement);
+    return statement == nullptr;
+  });
+}
+
+auto ConstantFolder::visit(PrintStatement *statement) -> StatementPtr {
+  statement->Expr = visit(statement->Expr);
+  return statement;
+}
+
+auto ConstantFolder::visit(VariableDeclaration *statement) -> StatementPtr {
+  statement->AssignedValue = visit(statement->AssignedValue);
+  return statement;
+}
+
+auto ConstantFolder::visit(Assignment *statement) -> StatementPtr {
+  statement->AssignmentValue = visit(statement->AssignmentValue);
+  return statement;
+}
+
+auto ConstantFolder::visit(BlockScope *statement) -> StatementPtr {
+  // the array is ours, so drop removed statements by shifting the rest down
+  auto kept = std::size_t{0};
+  for (auto *child : statement->Statements) {
+    if (auto *folded = visit(child)) {
+      statement->Statements[kept++] = folded;
+    }
+  }
+  statement->Statements = statement->Statements.first(kept);
+  return statement;
+}
+
+auto ConstantFolder::visit(IfStatement *statement) -> StatementPtr {
+  statement->Condition = visit(statement->Condition);
+  auto *if_body = visit(statement->IfBody);
+  auto *else_body = statement->ElseBody.has_value()
+                        ? visit(*statement->ElseBody)
+                        : static_cast<StatementPtr>(nullptr);
+  const auto *condition = asBool(statement->Condition);
+  auto *dropped = condition == nullptr ? nullptr
+                  : *condition         ? else_body
+                                       : if_body;
+  if (condition == nullptr || declaresOutsideBlock(dropped)) {
+    statement->IfBody = orEmptyBlock(if_body, statement->Line);
+    if (statement->ElseBody.has_value()) {
+      statement->ElseBody = orEmptyBlock(else_body, statement->Line);
+    }
+    return statement;
+  }
+  // only one side can ever run
+  removed_nodes_ += 2 + countNodes(dropped);
+  return *condition ? if_body : else_body;
+}
+
+auto ConstantFolder::visit(WhileStatement *statement) -> StatementPtr {
+  statement->Condition = visit(statement->Condition);
+  auto *body = visit(statement->Body);
+  const auto *condition = asBool(statement->Condition);
+  if (condition != nullptr && !*condition && !declaresOutsideBlock(body)) {
+    removed_nodes_ += 2 + countNodes(body);
+    return nullptr;
+  }
+  statement->Body = orEmptyBlock(body, statement->Line);
+  return statement;
+}
+
+auto ConstantFolder::visit(BinaryOperation *node) -> ExpressionPtr {
+  node->Left = visit(node->Left);
+  node->Right = visit(node->Right);
+  auto *left = asLiteral(node->Left);
+  auto *right = asLiteral(node->Right);
+  if (left != nullptr && right != nullptr) {
+    auto value = foldBinary(node->Operator, left->Value, right->Value,
+                            program_.Strings.get());
+    if (!value.has_value()) {
+      return node;
+    }
+    removed_nodes_ += 2; // the operation and one of the literals
+    return makeLiteral(*value, node->Line);
+  }
+  if (auto *simplified = simplify(node)) {
+    removed_nodes_ += 2; // the operation and the literal
+    return simplified;
+  }
+  return node;
+}
+
+auto ConstantFolder::visit(LogicalOperation *node) -> ExpressionPtr {
+  node->Left = visit(node->Left);
+  node->Right = visit(node->Right);
+  const auto *left = asBool(node->Left);
+  if (left == nullptr) {
+    return node;
+  }
+  // false && x and true || x never look at x
+  auto decided = node->Operator == TokenType::AND ? !*left : *left;
+  if (decided) {
+    removed_nodes_ += 1 + countNodes(node->Right);
+    return node->Left;
+  }
+  // otherwise it all comes down to the right side
+  if (asBool(node->Right) != nullptr) {
+    removed_nodes_ += 2;
+    return node->Right;
+  }
+  return node;
+}
+
+auto ConstantFolder::visit(UnaryOperation *node) -> ExpressionPtr {
+  node->Right = visit(node->Right);
+  auto *right = asLiteral(node->Right);
+  if (right == nullptr) {
+    return node;
+  }
+  if (const auto *number = std::get_if<double>(&right->Value);
+      number != nullptr && node->Operator == TokenType::MINUS) {
+    ++removed_nodes_;
+    return makeLiteral(-*number, node->Line);
+  }
+  if (const auto *boolean = std::get_if<bool>(&right->Value);
+      boolean != nullptr && node->Operator == TokenType::NOT) {
+    ++removed_nodes_;
+    return makeLiteral(!*boolean, node->Line);
+  }
+  return node;
+}
+
+auto ConstantFolder::visit(Grouping *node) -> ExpressionPtr {
+  // parentheses only matter to the parser
+  ++removed_nodes_;
+  return visit(node->Expr);
+}
+
+auto ConstantFolder::simplify(BinaryOperation *node) -> ExpressionPtr {
+  const auto *left = asDouble(node->Left);
+  const auto *right = asDouble(node->Right);
+  // all of these give back x bit for bit, including -0, inf and nan. x + 0
+  // isn't one of them (-0 + 0 is +0)
+  switch (node->Operator) {
+  case TokenType::MUL:
+    if (right != nullptr && *right == 1 && isFloat(node->Left)) {
+      return node->Left;
+    }
+    if (left != nullptr && *left == 1 && isFloat(node->Right)) {
+      return node->Right;
+    }
+    break;
+  case TokenType::DIV:
+    if (right != nullptr && *right == 1 && isFloat(node->Left)) {
+      return node->Left;
+    }
+    break;
+  case TokenType::MINUS:
+    if (right != nullptr && *right == 0 && !std::signbit(*right) &&
+        isFloat(node->Left)) {
+      return node->Left;
+    }
+    break;
+  case TokenType::PLUS:
+    if (right != nullptr && *right == 0 && std::signbit(*right) &&
+        isFloat(node->Left)) {
+      return node->Left;
+    }
+    if (left != nullptr && *left == 0 && std::signbit(*left) &&
+        isFloat(node->Right)) {
+      return node->Right;
+    }
+    break;
+  default:
+    break;
+  }
+  return nullptr;
+}
+
+auto ConstantFolder::isFloat(ExpressionPtr node) const -> bool {
+  switch (node->Kind) {
+  case ExpressionKind::Literal:
+    return std::holds_alternative<double>(static_cast<Literal *>(node)->Value);
+  case ExpressionKind::VariableEval:
+    return float_variables_.contains(static_cast<VariableEval *>(node)->Name);
+  case ExpressionKind::Grouping:
+    return isFloat(static_cast<Grouping *>(node)->Expr);
+  case ExpressionKind::UnaryOperation: {
+    auto *unary = static_cast<UnaryOperation *>(node);
+    return unary->Operator == TokenType::MINUS && isFloat(unary->Right);
+  }
+  case ExpressionKind::BinaryOperation: {
+    auto *binary = static_cast<BinaryOperation *>(node);
+    switch (binary->Operator) {
+    case TokenType::PLUS:
+    case TokenType::MINUS:
+    case TokenType::MUL:
+    case TokenType::DIV:
+      return isFloat(binary->Left) && isFloat(binary->Right);
+    default:
+      return false;
+    }
+  }
+  default:
+    return false;
+  }
+}
+
+auto ConstantFolder::findFloatVariables() -> void {
+  // every value each name is given, and the names that are declared as
+  // something other than Float somewhere
+  struct Collector {
+    std::unordered_map<std::string_view, std::vector<ExpressionPtr>> Values;
+    std::unordered_set<std::string_view> Declared;
+    std::unordered_set<std::string_view> NotFloat;
+
+    auto visit(Statement *statement) -> void {
+      visitStatement(*this, statement);
+    }
+    auto visit(InvalidStatement *statement) -> void {}
+    auto visit(PrintStatement *statement) -> void {}
+    auto visit(VariableDeclaration *statement) -> void {
+      Declared.insert(statement->Name);
+      if (statement->Type != "Float") {
+        NotFloat.insert(statement->Name);
+      }
+      Values[statement->Name].push_back(statement->AssignedValue);
+    }
+    auto visit(Assignment *statement) -> void {
+      Values[statement->Name].push_back(statement->AssignmentValue);
+    }
+    auto visit(BlockScope *statement) -> void {
+      for (auto *child : statement->Statements) {
+        visit(child);
+      }
+    }
+    auto visit(IfStatement *statement) -> void {
+      visit(statement->IfBody);
+      if (statement->ElseBody.has_value()) {
+        visit(*statement->ElseBody);
+      }
+    }
+    auto visit(WhileStatement *statement) -> void { visit(statement->Body); }
+  };
+  auto collector = Collector{};
+  for (auto *statement : program_.Statements) {
+    collector.visit(statement);
+  }
+  // the declared type is only a promise, start from every name declared Float
+  // and drop the ones that are ever given something else until nothing
+  // changes (x -> y; y -> "str"; takes two rounds to rule out x)
+  for (auto name : collector.Declared) {
+    if (!collector.NotFloat.contains(name)) {
+      float_variables_.insert(name);
+    }
+  }
+  auto changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = float_variables_.begin(); it != float_variables_.end();) {
+      auto &values = collector.Values[*it];
+      auto all_floats = std::all_of(
+          values.begin(), values.end(),
+          [&](ExpressionPtr value) { return isFloat(value); });
+      if (all_floats) {
+        ++it;
+        continue;
+      }
+      it = float_variables_.erase(it);
+      changed = true;
+    }
+  }
+}
+
+auto ConstantFolder::orEmptyBlock(StatementPtr statement, std::size_t line)
+    -> StatementPtr {
+  if (statement != nullptr) {
+    return statement;
+  }
+  auto *block = program_.Nodes.make<BlockScope>();
+  block->Line = line;
+  return block;
+}
+
+auto ConstantFolder::makeLiteral(const LiteralVariant &value, std::size_t line)
+    -> ExpressionPtr {
+  auto *literal = program_.Nodes.make<Literal>(value);
+  literal->Line = line;
+  return literal;
+}
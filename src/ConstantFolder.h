@@ -0,0 +1,70 @@
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include "AST.h"
+#include <string_view>
+#include <unordered_set>
+
+// AST pass between the parser and CodeGen. Folds operators on literals
+// (arithmetic, comparisons, string concatenation) into a single Literal and
+// drops operations that can't change a Float (x * 1, x - 0, ...). Anything
+// whose result could depend on the VM (division by zero, comparing strings or
+// mixed types) is left alone, so folded programs behave exactly the same.
+// Ifs and whiles whose condition folds to true or false lose the branch that
+// can never run (or disappear entirely).
+class ConstantFolder {
+public:
+  explicit ConstantFolder(ProgramNode &program);
+  // folds the whole program in place
+  auto run() -> void;
+  auto getRemovedNodes() const -> std::size_t { return removed_nodes_; }
+  // names that only ever hold numbers, known once run() has started
+  auto getFloatVariables() const
+      -> const std::unordered_set<std::string_view> & {
+    return float_variables_;
+  }
+
+  // statements return the statement that replaces them, nullptr if it can go
+  auto visit(Statement *statement) -> StatementPtr {
+    return visitStatement(*this, statement);
+  }
+  auto visit(InvalidStatement *statement) -> StatementPtr { return statement; }
+  auto visit(PrintStatement *statement) -> StatementPtr;
+  auto visit(VariableDeclaration *statement) -> StatementPtr;
+  auto visit(Assignment *statement) -> StatementPtr;
+  auto visit(BlockScope *statement) -> StatementPtr;
+  auto visit(IfStatement *statement) -> StatementPtr;
+  auto visit(WhileStatement *statement) -> StatementPtr;
+
+  // expressions return the node that replaces them
+  auto visit(Expression *node) -> ExpressionPtr {
+    return visitExpression(*this, node);
+  }
+  auto visit(BinaryOperation *node) -> ExpressionPtr;
+  auto visit(LogicalOperation *node) -> ExpressionPtr;
+  auto visit(UnaryOperation *node) -> ExpressionPtr;
+  auto visit(Grouping *node) -> ExpressionPtr;
+  auto visit(Literal *node) -> ExpressionPtr { return node; }
+  auto visit(VariableEval *node) -> ExpressionPtr { return node; }
+  auto visit(InvalidExpression *node) -> ExpressionPtr { return node; }
+
+private:
+  // finds the variables that are declared Float and only ever hold numbers,
+  // their type can be trusted for the identities
+  auto findFloatVariables() -> void;
+  // true if the expression always evaluates to a number
+  auto isFloat(ExpressionPtr node) const -> bool;
+  // x * 1, x / 1, x - 0 and x + -0 for a Float x, nullptr if none apply
+  auto simplify(BinaryOperation *node) -> ExpressionPtr;
+  auto makeLiteral(const LiteralVariant &value, std::size_t line)
+      -> ExpressionPtr;
+  // for bodies that were removed but have to be there
+  auto orEmptyBlock(StatementPtr statement, std::size_t line) -> StatementPtr;
+
+private:
+  ProgramNode &program_;
+  std::unordered_set<std::string_view> float_variables_;
+  std::size_t removed_nodes_ = 0;
+};
+
+#endif // !CONSTANT_FOLDER_H
@@ -0,0 +1,28 @@
+#include "ConstantPool.h"
+#include <bit>
+#include <string>
+
+ConstantPool::ConstantPool(Program &program) : program_{program} {}
+
+auto ConstantPool::addDouble(double value) -> int {
+  ++request_count_;
+  auto [it, inserted] =
+      doubles_.try_emplace(std::bit_cast<std::uint64_t>(value), -1);
+  if (inserted) {
+    it->second = program_.addConstant(
+        VortexValue{.Type = ValueType::DOUBLE, .Value = {.AsDouble = value}});
+  }
+  return it->second;
+}
+
+auto ConstantPool::addString(InternedString string) -> int {
+  ++request_count_;
+  auto [it, inserted] = strings_.try_emplace(string, -1);
+  if (inserted) {
+    // get the pointer to the string as a generic (Object*)
+    auto *ptr = program_.createString(std::string{string.view()});
+    it->second = program_.addConstant(
+        VortexValue{.Type = ValueType::OBJECT, .Value = {.AsObject = ptr}});
+  }
+  return it->second;
+}
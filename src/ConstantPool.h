@@ -0,0 +1,34 @@
+#ifndef CONSTANT_POOL_H
+#define CONSTANT_POOL_H
+
+#include "Program.h"
+#include "StringInterner.h"
+#include <cstdint>
+#include <unordered_map>
+
+// Hands out constant table indices for CodeGen, adding each distinct value to
+// the Program only once. Doubles are keyed by their bit pattern (0.0 and -0.0
+// stay apart, a NaN still finds itself), strings by their interned identity.
+// Returns -1 like Program::addConstant once the table is full.
+class ConstantPool {
+public:
+  explicit ConstantPool(Program &program);
+
+  auto addDouble(double value) -> int;
+  // the string object is only created the first time
+  auto addString(InternedString string) -> int;
+
+  // constants asked for vs constants actually in the table
+  auto getRequestCount() const -> std::size_t { return request_count_; }
+  auto getSize() const -> std::size_t {
+    return doubles_.size() + strings_.size();
+  }
+
+private:
+  Program &program_;
+  std::unordered_map<std::uint64_t, int> doubles_;
+  std::unordered_map<InternedString, int> strings_;
+  std::size_t request_count_ = 0;
+};
+
+#endif // !CONSTANT_POOL_H
@@ -0,0 +1,85 @@
+#include "Disassembler.h"
+#include <format>
+#include <iomanip>
+
+auto opcodeName(std::uint8_t op) -> std::string {
+  switch (op) {
+  case HALT:
+    return "HALT";
+  case PUSHC:
+    return "PUSHC";
+  case ADD:
+    return "ADD";
+  case SUB:
+    return "SUB";
+  case MUL:
+    return "MUL";
+  case DIV:
+    return "DIV";
+  case EQ:
+    return "EQ";
+  case LESS_EQ:
+    return "LESS_EQ";
+  case GREATER_EQ:
+    return "GREATER_EQ";
+  case LESS:
+    return "LESS";
+  case GREATER:
+    return "GREATER";
+  case NEGATE:
+    return "NEGATE";
+  case NOT:
+    return "NOT";
+  case PUSH_NIL:
+    return "PUSH_NIL";
+  case PUSH_TRUE:
+    return "PUSH_TRUE";
+  case PUSH_FALSE:
+    return "PUSH_FALSE";
+  case GET_LOCAL:
+    return "GET_LOCAL";
+  case LOAD_GLOB:
+    return "LOAD_GLOB";
+  case ADD_LOCAL:
+    return "ADD_LOCAL";
+  case SAVE_GLOB:
+    return "SAVE_GLOB";
+  case PRINT:
+    return "PRINT";
+  case SET_LOCAL:
+    return "SET_LOCAL";
+  case POP_LOCAL:
+    return "POP_LOCAL";
+  case JMP_TO_IF_FALSE:
+    return "JMP_TO_IF_FALSE";
+  case JMP_TO:
+    return "JMP_TO";
+  default:
+    return std::format("OP_{}", op);
+  }
+}
+
+auto disassemble(const Program &program, const LineTable &lines,
+                 std::ostream &out) -> void {
+  const auto &bytes = program.Bytecode;
+  auto last_line = std::size_t{0};
+  for (std::size_t at = 0; at < bytes.size();) {
+    auto line = lines.lineAt(at);
+    auto shown = at > 0 && line == last_line ? std::string{"|"}
+                                             : std::to_string(line);
+    last_line = line;
+    out << std::setfill('0') << std::setw(4) << at << ' ' << std::setfill(' ')
+        << std::setw(4) << shown << ' ' << opcodeName(bytes[at]);
+    if (bytes[at] == PUSHC && at + 3 < bytes.size()) {
+      auto index = (bytes[at + 1] << 16) | (bytes[at + 2] << 8) | bytes[at + 3];
+      out << ' ' << index;
+      if (index < static_cast<int>(program.Constants.size()) &&
+          program.Constants[index].Type == ValueType::DOUBLE) {
+        out << " (" << program.Constants[index].Value.AsDouble << ')';
+      }
+      at += 3;
+    }
+    out << '\n';
+    ++at;
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include "LineTable.h"
+#include "Program.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// name of an opcode, OP_<n> for a byte that isn't one
+auto opcodeName(std::uint8_t op) -> std::string;
+// One instruction per line: its offset, the source line (| when it's the
+// same as the one above) and the opcode, PUSHC with its constant.
+auto disassemble(const Program &program, const LineTable &lines,
+                 std::ostream &out) -> void;
+
+#endif // !DISASSEMBLER_H
@@ -0,0 +1,100 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include "Token.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Keyword recognition without allocating or hashing a std::string. The table
+// is a perfect hash built at compile time: every keyword gets its own slot, so
+// a lookup is one hash, one load and at most one string compare.
+
+struct Keyword {
+  std::string_view Text;
+  TokenType Type;
+};
+
+inline constexpr auto keyword_list = std::array{
+    Keyword{"Bool", TokenType::BOOL},     Keyword{"Float", TokenType::FLOAT},
+    Keyword{"String", TokenType::STRING}, Keyword{"if", TokenType::IF},
+    Keyword{"for", TokenType::FOR},       Keyword{"while", TokenType::WHILE},
+    Keyword{"create", TokenType::CREATE}, Keyword{"return", TokenType::RETURN},
+    Keyword{"class", TokenType::CLASS},   Keyword{"super", TokenType::SUPER},
+    Keyword{"extern", TokenType::EXTERN}, Keyword{"true", TokenType::TRUE},
+    Keyword{"false", TokenType::FALSE},   Keyword{"Array", TokenType::ARRAY},
+    Keyword{"nil", TokenType::NIL},       Keyword{"print", TokenType::PRINT},
+    Keyword{"fn", TokenType::FN},         Keyword{"else", TokenType::ELSE}};
+
+struct KeywordTable {
+  static constexpr auto Size = std::size_t{64};
+  std::uint32_t Seed = 0;
+  // index into keyword_list, -1 for empty slots
+  std::array<std::int8_t, Size> Slots{};
+  std::size_t MinLength = 0;
+  std::size_t MaxLength = 0;
+};
+
+// only looks at the length and the first two and last characters, which is
+// enough to tell the keywords apart (and cheap to compute)
+constexpr auto keywordHash(std::string_view word, std::uint32_t seed)
+    -> std::size_t {
+  auto byte = [](char ch) -> std::uint32_t {
+    return static_cast<unsigned char>(ch);
+  };
+  auto first = byte(word[0]);
+  auto second = byte(word[1]);
+  auto last = byte(word.back());
+  auto h = first * seed + (second << 3) + last * 31u +
+           static_cast<std::uint32_t>(word.size()) * 131u;
+  return (h ^ (h >> 7)) % KeywordTable::Size;
+}
+
+// tries seeds until one maps every keyword to a different slot
+consteval auto buildKeywordTable() -> KeywordTable {
+  auto table = KeywordTable{};
+  table.MinLength = keyword_list[0].Text.size();
+  for (const auto &keyword : keyword_list) {
+    table.MinLength = std::min(table.MinLength, keyword.Text.size());
+    table.MaxLength = std::max(table.MaxLength, keyword.Text.size());
+  }
+  for (auto seed = std::uint32_t{1}; seed < 4096; ++seed) {
+    table.Slots.fill(-1);
+    auto perfect = true;
+    for (auto i = std::size_t{0}; i < keyword_list.size() && perfect; ++i) {
+      auto &slot = table.Slots[keywordHash(keyword_list[i].Text, seed)];
+      perfect = slot == -1;
+      slot = static_cast<std::int8_t>(i);
+    }
+    if (perfect) {
+      table.Seed = seed;
+      return table;
+    }
+  }
+  return table;
+}
+
+inline constexpr auto keyword_table = buildKeywordTable();
+static_assert(keyword_table.Seed != 0,
+              "no perfect hash seed for the keyword set, grow the table");
+static_assert(keyword_table.MinLength >= 2,
+              "keywordHash reads the second character");
+
+// returns TokenType::IDENTIFIER for anything that isn't a keyword
+constexpr auto lookupKeyword(std::string_view word) -> TokenType {
+  if (word.size() < keyword_table.MinLength ||
+      word.size() > keyword_table.MaxLength) {
+    return TokenType::IDENTIFIER;
+  }
+  auto slot = keyword_table.Slots[keywordHash(word, keyword_table.Seed)];
+  if (slot == -1 || keyword_list[slot].Text != word) {
+    return TokenType::IDENTIFIER;
+  }
+  return keyword_list[slot].Type;
+}
+
+static_assert(lookupKeyword("while") == TokenType::WHILE);
+static_assert(lookupKeyword("whale") == TokenType::IDENTIFIER);
+
+#endif // !KEYWORDS_H
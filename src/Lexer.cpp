@@ -1,147 +1,298 @@
 #include "Lexer.h"
 #include "Error.h"
+#include "Keywords.h"
+#include "Scan.h"
 #include "Token.h"
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
 #include <format>
+#include <thread>
+
+namespace {
+// below this much text per chunk the threads cost more than they save
+constexpr auto min_chunk_size = std::size_t{256 * 1024};
+
+// Picks chunks - 1 places to split the text at, roughly evenly spaced. Each
+// split goes right after the first newline past its target, found without
+// looking at anything before it, so a # comment can't straddle two chunks but
+// a string with newlines in it can. lexParallel checks for that. The result
+// starts with 0 and ends with text.size().
+auto findSplitPoints(std::string_view text, std::size_t chunks)
+    -> std::vector<std::size_t> {
+  auto splits = std::vector<std::size_t>{0};
+  for (auto k = std::size_t{1}; k < chunks; ++k) {
+    auto target = std::max(text.size() / chunks * k, splits.back());
+    auto pos = scanToNewline(text, target);
+    if (pos + 1 >= text.size()) {
+      break;
+    }
+    if (pos + 1 > splits.back()) {
+      splits.push_back(pos + 1);
+    }
+  }
+  splits.push_back(text.size());
+  return splits;
+}
+} // namespace
+
+Lexer::Lexer(SourcePtr source, std::ofstream *debug_file)
+    : Lexer{std::move(source), std::make_shared<StringInterner>(),
+            debug_file} {}
+
+Lexer::Lexer(SourcePtr source, InternerPtr strings, std::ofstream *debug_file)
+    : debug_file_{debug_file}, source_{std::move(source)},
+      strings_{std::move(strings)}, file_{source_->getText()},
+      filename_{source_->getName()} {}
+
+Lexer::Lexer(SourcePtr source, std::size_t begin, std::size_t end)
+    : Lexer{std::move(source)} {
+  file_ = file_.substr(0, end);
+  token_start_ = pos_ = begin;
+  defer_errors_ = true;
+}
 
 Lexer::Lexer(std::string_view file, std::string_view filename,
              std::ofstream *debug_file)
-    : file_{file}, filename_{filename}, debug_file_{debug_file} {}
+    : Lexer{SourceFile::fromString(file, filename), debug_file} {}
 
 auto Lexer::lex() -> void {
-  while (pos_ < file_.size()) {
-    switch (auto ch = consume()) {
-    case '\n':
-      line_++;
-      break;
-    case ' ':
-    case '\t': // something historic i think
-    case '\r':
-      break;
-    case '#':
-      removeComment();
-      break;
-    case '{':
-      addToken(TokenType::L_BRACE);
-      break;
-    case '}':
-      addToken(TokenType::R_BRACE);
-      break;
-    case '(':
-      addToken(TokenType::L_PAREN);
-      break;
-    case ')':
-      addToken(TokenType::R_PAREN);
-      break;
-    case '[':
-      addToken(TokenType::L_BRACE);
-      break;
-    case ':':
-      addToken(TokenType::COLON);
-      break;
-    case ']':
-      addToken(TokenType::R_BRACE);
-      break;
-    case '+':
-      addToken(TokenType::PLUS);
-      break;
-    case '*':
-      addToken(TokenType::MUL);
-      break;
-    case '/':
-      addToken(TokenType::DIV);
-      break;
-    case '.':
-      addToken(TokenType::DOT);
-      break;
-    case ',':
-      addToken(TokenType::COMMA);
-      break;
-    case ';':
-      addToken(TokenType::SEMICOLON);
-      break;
-    case '=':
-      if (peek() == '>') {
-        consume();
-        addToken(TokenType::THICK_ARROW);
-        break;
-      }
-      addToken(TokenType::EQUALITY);
-      break;
-    case '"':
-      addString();
-      break;
-    case '-':
-      if (peek() == '>') {
-        consume(); // the right angle
-        addToken(TokenType::ASSIGNMENT);
-      } else {
-        addToken(TokenType::MINUS);
-      }
-      break;
-    case '>':
-      if (peek() == '=') {
-        consume();
-        addToken(TokenType::GREATER_THAN_OR_EQUAL);
-      } else {
-        addToken(TokenType::GREATER_THAN);
-      }
-      break;
-    case '<':
-      if (peek() == '=') {
-        consume();
-        addToken(TokenType::LESS_THAN_OR_EQUAL);
-      } else {
-        addToken(TokenType::LESS_THAN);
+  auto threads = std::size_t{std::thread::hardware_concurrency()};
+  auto chunks = std::min(threads, file_.size() / min_chunk_size);
+  if (file_.size() >= ParallelThreshold && chunks > 1) {
+    lexParallel(chunks);
+    return;
+  }
+  do {
+    tokens_.push_back(next());
+  } while (tokens_.back().Type != TokenType::END_OF_FILE);
+}
+
+auto Lexer::lexParallel(std::size_t chunks) -> void {
+  struct Chunk {
+    std::vector<Token> Tokens;
+    std::vector<DeferredError> Errors;
+    std::size_t Newlines = 0;
+    InternerPtr Strings;
+    bool EndsInString = false;
+  };
+  auto splits = findSplitPoints(file_, std::max(chunks, std::size_t{1}));
+  auto results = std::vector<Chunk>(splits.size() - 1);
+  auto next_chunk = std::atomic<std::size_t>{0};
+  auto worker = [&] {
+    for (auto i = next_chunk++; i < results.size(); i = next_chunk++) {
+      // every chunk starts counting at line 1, fixed up below
+      auto lexer = Lexer{source_, splits[i], splits[i + 1]};
+      for (auto token = lexer.next(); token.Type != TokenType::END_OF_FILE;
+           token = lexer.next()) {
+        results[i].Tokens.push_back(std::move(token));
       }
-      break;
-    case '!':
-      if (peek() == '=') {
-        consume();
-        addToken(TokenType::INEQUALITY);
-      } else {
-        addToken(TokenType::NOT);
+      results[i].Errors = std::move(lexer.deferred_errors_);
+      results[i].Newlines = lexer.line_ - 1;
+      results[i].Strings = lexer.strings_;
+      results[i].EndsInString = lexer.ends_in_string_;
+    }
+  };
+  auto pool = std::vector<std::thread>{};
+  auto threads = std::min<std::size_t>(std::thread::hardware_concurrency(),
+                                       results.size());
+  for (auto i = std::size_t{1}; i < threads; ++i) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+
+  // stitch the chunks back together in order, as if lexed in one go
+  for (auto i = std::size_t{0}; i < results.size(); ++i) {
+    auto &chunk = results[i];
+    if (chunk.EndsInString && i + 1 < results.size()) {
+      // the split after this chunk cut a string in two, so every chunk from
+      // here on started in the wrong place. Lex the rest one token at a time.
+      resumeAt(splits[i], line_);
+      do {
+        tokens_.push_back(next());
+      } while (tokens_.back().Type != TokenType::END_OF_FILE);
+      return;
+    }
+    auto line_offset = line_ - 1;
+    for (const auto &error : chunk.Errors) {
+      reportError(error.Message, filename_, error.Line + line_offset);
+    }
+    for (auto &token : chunk.Tokens) {
+      token.Line += line_offset;
+      // move the strings over from the chunk's own interner
+      if (auto *str = std::get_if<InternedString>(&token.Value)) {
+        *str = strings_->intern(str->view());
       }
-      break;
-    case '&':
-      if (peek() != '&') {
-        reportError("Expected & after &!", file_, line_);
-        addToken(TokenType::INVALID);
-        break;
+      if (debug_file_ != nullptr) {
+        prettyPrint(*debug_file_, token);
       }
+      tokens_.push_back(std::move(token));
+    }
+    line_ += chunk.Newlines;
+  }
+  token_start_ = pos_ = file_.size();
+  tokens_.push_back(next()); // END_OF_FILE
+}
+
+auto Lexer::resumeAt(std::size_t pos, std::size_t line) -> void {
+  token_start_ = pos_ = pos;
+  line_ = line;
+}
+
+auto Lexer::next() -> Token {
+  has_token_ = false;
+  while (!has_token_ && pos_ < file_.size()) {
+    scanToken();
+    // move on to the next ch
+    token_start_ = pos_;
+  }
+  if (!has_token_) {
+    addToken(TokenType::END_OF_FILE);
+  }
+  // log all the tokens for debug purposes
+  if (debug_file_ != nullptr) {
+    prettyPrint(*debug_file_, token_);
+  }
+  return std::move(token_);
+}
+
+auto Lexer::scanToken() -> void {
+  switch (auto ch = consume()) {
+  case '\n':
+  case ' ':
+  case '\t': // something historic i think
+  case '\r':
+    // skip the whole run at once, the kernel counts the newlines
+    pos_ = scanWhitespace(file_, pos_ - 1, line_);
+    break;
+  case '#':
+    removeComment();
+    break;
+  case '{':
+    addToken(TokenType::L_BRACE);
+    break;
+  case '}':
+    addToken(TokenType::R_BRACE);
+    break;
+  case '(':
+    addToken(TokenType::L_PAREN);
+    break;
+  case ')':
+    addToken(TokenType::R_PAREN);
+    break;
+  case '[':
+    addToken(TokenType::L_BRACE);
+    break;
+  case ':':
+    addToken(TokenType::COLON);
+    break;
+  case ']':
+    addToken(TokenType::R_BRACE);
+    break;
+  case '+':
+    addToken(TokenType::PLUS);
+    break;
+  case '*':
+    addToken(TokenType::MUL);
+    break;
+  case '/':
+    addToken(TokenType::DIV);
+    break;
+  case '.':
+    addToken(TokenType::DOT);
+    break;
+  case ',':
+    addToken(TokenType::COMMA);
+    break;
+  case ';':
+    addToken(TokenType::SEMICOLON);
+    break;
+  case '=':
+    if (peek() == '>') {
       consume();
-      addToken(TokenType::AND);
+      addToken(TokenType::THICK_ARROW);
       break;
-    case '|':
-      if (peek() != '|') {
-        reportError("Expected | after |!", file_, line_);
-        addToken(TokenType::INVALID);
-        break;
-      }
+    }
+    addToken(TokenType::EQUALITY);
+    break;
+  case '"':
+    addString();
+    break;
+  case '-':
+    if (peek() == '>') {
+      consume(); // the right angle
+      addToken(TokenType::ASSIGNMENT);
+    } else {
+      addToken(TokenType::MINUS);
+    }
+    break;
+  case '>':
+    if (peek() == '=') {
+      consume();
+      addToken(TokenType::GREATER_THAN_OR_EQUAL);
+    } else {
+      addToken(TokenType::GREATER_THAN);
+    }
+    break;
+  case '<':
+    if (peek() == '=') {
       consume();
-      addToken(TokenType::OR);
+      addToken(TokenType::LESS_THAN_OR_EQUAL);
+    } else {
+      addToken(TokenType::LESS_THAN);
+    }
+    break;
+  case '!':
+    if (peek() == '=') {
+      consume();
+      addToken(TokenType::INEQUALITY);
+    } else {
+      addToken(TokenType::NOT);
+    }
+    break;
+  case '&':
+    if (peek() != '&') {
+      error("Expected & after &!");
+      addToken(TokenType::INVALID);
       break;
-    default:
-      if (isalpha(ch) || ch == '_') {
-        addIdentifierOrKeyword(ch);
-        break;
-      } else if (isdigit(ch)) {
-        addNumber();
-        break;
-      }
-      reportError(std::format("Unexpected token '{}'!", ch), filename_, line_);
+    }
+    consume();
+    addToken(TokenType::AND);
+    break;
+  case '|':
+    if (peek() != '|') {
+      error("Expected | after |!");
       addToken(TokenType::INVALID);
       break;
     }
-    // move on to the next ch
-    token_start_ = pos_;
+    consume();
+    addToken(TokenType::OR);
+    break;
+  default:
+    if (isalpha(ch) || ch == '_') {
+      addIdentifierOrKeyword(ch);
+      break;
+    } else if (isdigit(ch)) {
+      addNumber();
+      break;
+    }
+    error(std::format("Unexpected token '{}'!", ch));
+    addToken(TokenType::INVALID);
+    break;
   }
-  addToken(TokenType::END_OF_FILE);
+}
 
-  // log all the tokens for debug purposes
-  if (debug_file_ != nullptr) {
-    prettyPrint(*debug_file_, tokens_);
+auto Lexer::error(std::string_view message) -> void {
+  if (defer_errors_) {
+    deferred_errors_.push_back(
+        {.Message = std::string{message}, .Line = line_});
+    return;
   }
+  reportError(message, filename_, line_);
 }
 
 auto Lexer::consume() -> char {
@@ -149,9 +300,9 @@ auto Lexer::consume() -> char {
   return file_[pos_ - 1];
 }
 
-auto Lexer::peek() -> char {
-  if (pos_ < file_.size()) {
-    return file_[pos_];
+auto Lexer::peek(std::size_t n) -> char {
+  if (pos_ + n < file_.size()) {
+    return file_[pos_ + n];
   }
   return '\0';
 }
@@ -160,64 +311,97 @@ auto Lexer::convertIdentifier() -> TokenType { return {}; }
 
 auto Lexer::addToken(TokenType type, LiteralVariant value) -> void {
   auto lexeme = file_.substr(token_start_, pos_ - token_start_);
-  auto tok =
-      Token{.Lexeme = lexeme, .Line = line_, .Value = value, .Type = type};
-  tokens_.push_back(tok);
+  token_ = Token{.Lexeme = lexeme, .Line = line_, .Value = value, .Type = type};
+  has_token_ = true;
 }
 
 auto Lexer::addString() -> void {
-  auto error = bool{false};
-  auto ch = consume();
-  while (pos_ < file_.size() && ch != '"') {
-    if (ch == '\n') {
-      ++line_;
-    }
-    ch = consume();
-  }
-  if (pos_ == file_.size()) {
-    reportError("Unterminated string literal!", filename_, line_);
+  auto end = scanToQuote(file_, pos_, line_);
+  if (end == file_.size()) {
+    pos_ = end;
+    ends_in_string_ = true;
+    error("Unterminated string literal!");
     return;
-  } else {
-    auto literal = file_.substr(token_start_ + 1, pos_ - token_start_ - 2);
-    addToken(TokenType::STRING_LITERAL, literal);
   }
+  pos_ = end + 1; // the closing quote
+  auto literal = file_.substr(token_start_ + 1, end - token_start_ - 1);
+  addToken(TokenType::STRING_LITERAL, strings_->intern(literal));
 }
 
 auto Lexer::addIdentifierOrKeyword(char ch) -> void {
-  while (pos_ < file_.size() && (isalnum(peek()) || peek() == '_')) {
-    consume();
-  }
+  pos_ = scanIdentifier(file_, pos_);
   auto word = file_.substr(token_start_, pos_ - token_start_);
-  if (token_to_keyword_.contains(word)) {
-    addToken(token_to_keyword_[word]);
-    return;
-  }
-  addToken(TokenType::IDENTIFIER);
+  addToken(lookupKeyword(word));
 }
 
 auto Lexer::addNumber() -> void {
-  while (pos_ < file_.size() && isdigit(peek())) {
+  // 0x1F, 0x1.8p3 etc. are hex, everything else is decimal
+  auto hex = file_[token_start_] == '0' && (peek() == 'x' || peek() == 'X');
+  auto digits_start = token_start_;
+  if (hex) {
+    consume(); // the x
+    digits_start = pos_;
+  }
+  auto is_digit = [hex](char ch) -> bool {
+    auto byte = static_cast<unsigned char>(ch);
+    return hex ? isxdigit(byte) : isdigit(byte);
+  };
+  if (hex && !is_digit(peek())) {
+    error("Expected hex digits after '0x'!");
+    addToken(TokenType::INVALID);
+    return;
+  }
+  while (is_digit(peek())) {
     consume();
   }
   if (peek() == '.') {
     consume();
-    if (!isdigit(peek())) {
-      reportError("Expected digits after '.' in floating point literal!",
-                  filename_, line_);
+    if (!is_digit(peek())) {
+      error("Expected digits after '.' in floating point literal!");
       addToken(TokenType::INVALID);
       return;
     }
-    while (pos_ < file_.size() && isdigit(peek())) {
+    while (is_digit(peek())) {
       consume();
     }
   }
-  auto numstr = file_.substr(token_start_, pos_ - token_start_);
-  auto value = std::stod(numstr);
+  // the exponent is only taken if digits follow, 'p' for hex since 'e' is a
+  // hex digit
+  auto exponent = hex ? 'p' : 'e';
+  if (tolower(peek()) == exponent) {
+    auto has_sign = peek(1) == '+' || peek(1) == '-';
+    if (isdigit(static_cast<unsigned char>(peek(has_sign ? 2 : 1)))) {
+      pos_ += has_sign ? 2 : 1;
+      while (isdigit(static_cast<unsigned char>(peek()))) {
+        consume();
+      }
+    }
+  }
+  // straight off the source buffer, no copies and no locale
+  auto digits = file_.substr(digits_start, pos_ - digits_start);
+  auto value = double{};
+  auto format = hex ? std::chars_format::hex : std::chars_format::general;
+  auto [end, status] = std::from_chars(
+      digits.data(), digits.data() + digits.size(), value, format);
+  if (status == std::errc::result_out_of_range) {
+    error(std::format("Number literal '{}' is out of range!",
+                      file_.substr(token_start_, pos_ - token_start_)));
+    addToken(TokenType::INVALID);
+    return;
+  }
+  if (status != std::errc{} || end != digits.data() + digits.size()) {
+    error(std::format("Invalid number literal '{}'!",
+                      file_.substr(token_start_, pos_ - token_start_)));
+    addToken(TokenType::INVALID);
+    return;
+  }
   addToken(TokenType::FLOAT_LITERAL, value);
 }
 
 auto Lexer::removeComment() -> void {
-  while (pos_ < file_.size() && consume() != '\n') {
+  pos_ = scanToNewline(file_, pos_);
+  if (pos_ < file_.size()) {
+    ++pos_; // the newline
   }
   line_++;
 }
@@ -1,11 +1,11 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "Source.h"
 #include "Token.h"
 #include <fstream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
 struct TokenizedFile {
@@ -15,18 +15,56 @@ struct TokenizedFile {
 
 class Lexer {
 public:
+  static constexpr auto ParallelThreshold = std::size_t{1} << 20;
+
+  explicit Lexer(SourcePtr source, std::ofstream *debug_file = nullptr);
+  // string literals are interned into strings (shared with whoever else uses
+  // it) instead of a fresh interner
+  explicit Lexer(SourcePtr source, InternerPtr strings,
+                 std::ofstream *debug_file = nullptr);
+  // copies the text into a fresh SourceFile
   explicit Lexer(std::string_view file, std::string_view filename,
                  std::ofstream *debug_file = nullptr);
+  // batch mode: lex() the whole file up front, then look at getTokens()
   auto getTokens() const -> const std::vector<Token> & { return tokens_; }
+  // token lexemes point into this, keep it around as long as the tokens
+  auto getSource() const -> const SourcePtr & { return source_; }
+  // owns the string literal values of the tokens
+  auto getInterner() const -> const InternerPtr & { return strings_; }
+  // files of at least ParallelThreshold bytes are lexed on all cores
   auto lex() -> void;
+  // splits the file into (at most) this many chunks and lexes them on a
+  // thread pool. The tokens and error reports are the same as lexing the file
+  // sequentially. A string with newlines in it across a split makes it fall
+  // back to lexing the rest of the file on this thread.
+  auto lexParallel(std::size_t chunks) -> void;
+  // picks up lexing at pos as if line had been reached there. pos has to be
+  // between two tokens, not inside a string or comment.
+  auto resumeAt(std::size_t pos, std::size_t line) -> void;
+  // streaming mode: hands out one token at a time, END_OF_FILE once the file
+  // is exhausted
+  auto next() -> Token;
 
 private:
+  struct DeferredError {
+    std::string Message;
+    std::size_t Line;
+  };
+
+private:
+  // lexes [begin, end) of source without an END_OF_FILE at the end, errors are
+  // collected instead of reported (a chunk of a parallel lex)
+  Lexer(SourcePtr source, std::size_t begin, std::size_t end);
+  auto error(std::string_view message) -> void;
   // consume() is one character behind of the pos_ variable,
   // so for matching cases like '->' or '!=' this is useful
-  auto peek() -> char;
+  auto peek(std::size_t n = 0) -> char;
   auto consume() -> char;
+  // consumes characters until they make up a token (or were skipped)
+  auto scanToken() -> void;
   auto convertIdentifier() -> TokenType;
   auto addToken(TokenType type, LiteralVariant value = None{}) -> void;
+  // decimal (with optional fraction and exponent) or 0x hex
   auto addNumber() -> void;
   auto addString() -> void;
   // ch = first character of the lexeme
@@ -38,21 +76,18 @@ private:
   std::size_t pos_ = 0;
   std::size_t line_ = 1;
   std::ofstream *debug_file_;
-  std::string file_;
-  std::string filename_;
+  SourcePtr source_;
+  InternerPtr strings_;
+  std::string_view file_;
+  std::string_view filename_;
   std::vector<Token> tokens_;
-
-  std::unordered_map<std::string, TokenType> token_to_keyword_ = {
-      {"Bool", TokenType::BOOL},     {"Float", TokenType::FLOAT},
-      {"String", TokenType::STRING}, {"if", TokenType::IF},
-      {"for", TokenType::FOR},       {"while", TokenType::WHILE},
-      {"create", TokenType::CREATE}, {"return", TokenType::RETURN},
-      {"class", TokenType::CLASS},   {"super", TokenType::SUPER},
-      {"extern", TokenType::EXTERN}, {"true", TokenType::TRUE},
-      {"false", TokenType::FALSE},   {"Array", TokenType::ARRAY},
-      {"class", TokenType::CLASS},   {"nil", TokenType::NIL},
-      {"print", TokenType::PRINT},   {"fn", TokenType::FN},
-      {"else", TokenType::ELSE}};
+  // the token the last scanToken() produced, if any
+  Token token_;
+  bool has_token_ = false;
+  bool defer_errors_ = false;
+  // ran into the end of the text inside a string literal
+  bool ends_in_string_ = false;
+  std::vector<DeferredError> deferred_errors_;
 };
 
 #endif // LEXER_H
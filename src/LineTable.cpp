@@ -0,0 +1,20 @@
+#include "LineTable.h"
+#include <algorithm>
+
+auto LineTable::append(std::size_t line) -> void {
+  // a different line starts a new run
+  if (lines_.empty() || lines_.back() != line) {
+    starts_.push_back(static_cast<std::uint32_t>(size_));
+    lines_.push_back(static_cast<std::uint32_t>(line));
+  }
+  ++size_;
+}
+
+auto LineTable::lineAt(std::size_t pc) const -> std::size_t {
+  // the last run starting at or before pc
+  auto run = std::upper_bound(starts_.begin(), starts_.end(), pc);
+  if (run == starts_.begin()) {
+    return 0;
+  }
+  return lines_[std::distance(starts_.begin(), run) - 1];
+}
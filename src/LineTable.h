@@ -0,0 +1,33 @@
+#ifndef LINE_TABLE_H
+#define LINE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Source lines of a program's bytecode, stored as one entry per run of bytes
+// that share a line instead of one line per byte. An instruction's operand
+// bytes and most statements' whole code are a single run. Built as the code
+// is written, lookups are a binary search, they only happen for errors and
+// disassembly.
+class LineTable {
+public:
+  // the next byte of the program came from line
+  auto append(std::size_t line) -> void;
+  // the line the byte at pc was compiled from
+  auto lineAt(std::size_t pc) const -> std::size_t;
+  // bytes covered so far
+  auto size() const -> std::size_t { return size_; }
+  auto getRunCount() const -> std::size_t { return starts_.size(); }
+  auto getBytesUsed() const -> std::size_t {
+    return starts_.size() * (sizeof(std::uint32_t) + sizeof(std::uint32_t));
+  }
+
+private:
+  // first pc of each run, ascending, and the line of that run
+  std::vector<std::uint32_t> starts_;
+  std::vector<std::uint32_t> lines_;
+  std::size_t size_ = 0;
+};
+
+#endif // !LINE_TABLE_H
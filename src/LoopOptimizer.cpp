@@ -0,0 +1,265 @@
+#include "LoopOptimizer.h"
+#include "Token.h"
+#include <format>
+#include <vector>
+
+namespace {
+// every name a loop declares or assigns, anything that reads one of them can
+// change between passes (or see a different variable)
+struct WrittenNames {
+  std::unordered_set<std::string_view> Names;
+
+  auto visit(Statement *statement) -> void {
+    visitStatement(*this, statement);
+  }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void {}
+  auto visit(VariableDeclaration *statement) -> void {
+    Names.insert(statement->Name);
+  }
+  auto visit(Assignment *statement) -> void { Names.insert(statement->Name); }
+  auto visit(BlockScope *statement) -> void {
+    for (auto *child : statement->Statements) {
+      visit(child);
+    }
+  }
+  auto visit(IfStatement *statement) -> void {
+    visit(statement->IfBody);
+    if (statement->ElseBody.has_value()) {
+      visit(*statement->ElseBody);
+    }
+  }
+  auto visit(WhileStatement *statement) -> void { visit(statement->Body); }
+};
+
+// Swaps every invariant expression in a loop (inner loops included) for a
+// hidden local and keeps the declarations to put in front of it.
+struct Hoister {
+  ProgramNode &Program;
+  const std::unordered_set<std::string_view> &Floats;
+  const std::unordered_set<std::string_view> &Written;
+  // declared on every path to the loop, so reading them before it is fine
+  const std::unordered_set<std::string_view> &Declared;
+  std::size_t &Count;
+  std::vector<StatementPtr> Declarations;
+
+  auto visit(Statement *statement) -> void {
+    visitStatement(*this, statement);
+  }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void {
+    statement->Expr = replace(statement->Expr);
+  }
+  auto visit(VariableDeclaration *statement) -> void {
+    statement->AssignedValue = replace(statement->AssignedValue);
+  }
+  auto visit(Assignment *statement) -> void {
+    statement->AssignmentValue = replace(statement->AssignmentValue);
+  }
+  auto visit(BlockScope *statement) -> void {
+    for (auto *child : statement->Statements) {
+      visit(child);
+    }
+  }
+  auto visit(IfStatement *statement) -> void {
+    statement->Condition = replace(statement->Condition);
+    visit(statement->IfBody);
+    if (statement->ElseBody.has_value()) {
+      visit(*statement->ElseBody);
+    }
+  }
+  auto visit(WhileStatement *statement) -> void {
+    statement->Condition = replace(statement->Condition);
+    visit(statement->Body);
+  }
+
+  // the largest invariant pieces of node become hidden locals
+  auto replace(ExpressionPtr node) -> ExpressionPtr {
+    // a literal or a variable is as cheap as the hidden local
+    auto worth_it = node->Kind != ExpressionKind::Literal &&
+                    node->Kind != ExpressionKind::VariableEval;
+    if (auto type = invariantType(node); worth_it && !type.empty()) {
+      return hoist(node, type);
+    }
+    switch (node->Kind) {
+    case ExpressionKind::BinaryOperation: {
+      auto *binary = static_cast<BinaryOperation *>(node);
+      binary->Left = replace(binary->Left);
+      binary->Right = replace(binary->Right);
+      break;
+    }
+    case ExpressionKind::LogicalOperation: {
+      // a side that may not run can still move, it can't fail either
+      auto *logical = static_cast<LogicalOperation *>(node);
+      logical->Left = replace(logical->Left);
+      logical->Right = replace(logical->Right);
+      break;
+    }
+    case ExpressionKind::UnaryOperation: {
+      auto *unary = static_cast<UnaryOperation *>(node);
+      unary->Right = replace(unary->Right);
+      break;
+    }
+    default:
+      break;
+    }
+    return node;
+  }
+
+  // "Float" or "Bool" for something that can move out of the loop, empty
+  // otherwise
+  auto invariantType(ExpressionPtr node) const -> std::string_view {
+    if (isInvariantFloat(node)) {
+      return "Float";
+    }
+    if (node->Kind != ExpressionKind::BinaryOperation) {
+      return {};
+    }
+    auto *binary = static_cast<BinaryOperation *>(node);
+    switch (binary->Operator) {
+    case TokenType::EQUALITY:
+    case TokenType::INEQUALITY:
+    case TokenType::LESS_THAN:
+    case TokenType::LESS_THAN_OR_EQUAL:
+    case TokenType::GREATER_THAN:
+    case TokenType::GREATER_THAN_OR_EQUAL:
+      if (isInvariantFloat(binary->Left) && isInvariantFloat(binary->Right)) {
+        return "Bool";
+      }
+      return {};
+    default:
+      return {};
+    }
+  }
+
+  // a number that can't change inside the loop and can be computed in front
+  // of it without failing
+  auto isInvariantFloat(ExpressionPtr node) const -> bool {
+    switch (node->Kind) {
+    case ExpressionKind::Literal:
+      return std::holds_alternative<double>(
+          static_cast<Literal *>(node)->Value);
+    case ExpressionKind::VariableEval: {
+      auto name = static_cast<VariableEval *>(node)->Name;
+      return Floats.contains(name) && !Written.contains(name) &&
+             Declared.contains(name);
+    }
+    case ExpressionKind::UnaryOperation: {
+      auto *unary = static_cast<UnaryOperation *>(node);
+      return unary->Operator == TokenType::MINUS &&
+             isInvariantFloat(unary->Right);
+    }
+    case ExpressionKind::BinaryOperation: {
+      auto *binary = static_cast<BinaryOperation *>(node);
+      switch (binary->Operator) {
+      case TokenType::PLUS:
+      case TokenType::MINUS:
+      case TokenType::MUL:
+        return isInvariantFloat(binary->Left) &&
+               isInvariantFloat(binary->Right);
+      case TokenType::DIV: {
+        // leave dividing by zero to happen where it was written
+        auto *divisor = binary->Right->Kind == ExpressionKind::Literal
+                            ? std::get_if<double>(
+                                  &static_cast<Literal *>(binary->Right)->Value)
+                            : nullptr;
+        return divisor != nullptr && *divisor != 0 &&
+               isInvariantFloat(binary->Left);
+      }
+      default:
+        return false;
+      }
+    }
+    default:
+      return false;
+    }
+  }
+
+  auto hoist(ExpressionPtr node, std::string_view type) -> ExpressionPtr {
+    // $ can't start an identifier, so these never clash with the program's
+    auto name = Program.Nodes.copyString(std::format("${}", Count++));
+    auto *declaration = Program.Nodes.make<VariableDeclaration>();
+    declaration->Line = node->Line;
+    declaration->Type = type;
+    declaration->Name = name;
+    declaration->AssignedValue = node;
+    Declarations.push_back(declaration);
+    auto *local = Program.Nodes.make<VariableEval>(name);
+    local->Line = node->Line;
+    return local;
+  }
+};
+} // namespace
+
+LoopOptimizer::LoopOptimizer(
+    ProgramNode &program,
+    const std::unordered_set<std::string_view> &float_variables)
+    : program_{program}, float_variables_{float_variables} {}
+
+auto LoopOptimizer::run() -> void {
+  for (auto &statement : program_.Statements) {
+    statement = visit(statement);
+  }
+}
+
+auto LoopOptimizer::visit(VariableDeclaration *statement) -> StatementPtr {
+  declared_.insert(statement->Name);
+  return statement;
+}
+
+auto LoopOptimizer::visit(BlockScope *statement) -> StatementPtr {
+  auto outer_depth = scope_depth_;
+  auto outer_declared = declared_;
+  scope_depth_ = statement->ScopeDepth;
+  for (auto &child : statement->Statements) {
+    child = visit(child);
+  }
+  scope_depth_ = outer_depth;
+  declared_ = std::move(outer_declared);
+  return statement;
+}
+
+auto LoopOptimizer::visit(IfStatement *statement) -> StatementPtr {
+  // neither branch is sure to run
+  auto outer_declared = declared_;
+  statement->IfBody = visit(statement->IfBody);
+  declared_ = outer_declared;
+  if (statement->ElseBody.has_value()) {
+    statement->ElseBody = visit(*statement->ElseBody);
+    declared_ = std::move(outer_declared);
+  }
+  return statement;
+}
+
+auto LoopOptimizer::visit(WhileStatement *statement) -> StatementPtr {
+  // outer loops go first, so an expression moves as far out as it can
+  auto written = WrittenNames{};
+  written.visit(statement);
+  auto hoister = Hoister{.Program = program_,
+                         .Floats = float_variables_,
+                         .Written = written.Names,
+                         .Declared = declared_,
+                         .Count = hoisted_count_};
+  // the hidden locals need a block around the loop, which must not swallow
+  // anything the loop declares for the code after it
+  auto can_wrap = !declaresOutsideBlock(statement);
+  if (can_wrap) {
+    statement->Condition = hoister.replace(statement->Condition);
+    hoister.visit(statement->Body);
+  }
+  // then whatever only stays the same in the inner loops. The body might not
+  // run, so nothing it declares counts afterwards.
+  auto outer_declared = declared_;
+  statement->Body = visit(statement->Body);
+  declared_ = std::move(outer_declared);
+  if (hoister.Declarations.empty()) {
+    return statement;
+  }
+  hoister.Declarations.push_back(statement);
+  auto *block = program_.Nodes.make<BlockScope>();
+  block->Line = statement->Line;
+  block->ScopeDepth = scope_depth_ + 1;
+  block->Statements = program_.Nodes.copyArray(
+      std::span<const StatementPtr>{hoister.Declarations});
+  return block;
+}
@@ -0,0 +1,47 @@
+#ifndef LOOP_OPTIMIZER_H
+#define LOOP_OPTIMIZER_H
+
+#include "AST.h"
+#include <string_view>
+#include <unordered_set>
+
+// AST pass between the ConstantFolder and the Resolver. Moves expressions
+// that come out the same on every pass through a while loop in front of it:
+//   while i < n * 2 { ... }  =>  { $0: Float -> n * 2; while i < $0 { ... } }
+// Only arithmetic and comparisons on trusted Floats (see the ConstantFolder)
+// that nothing in the loop writes to and that are declared on every path to
+// the loop are moved. Those can't fail in the VM, so running them once before
+// a loop that never runs changes nothing. A loop that declares something
+// into the scope around it (`while c x: Float -> 1;`) is left alone, the
+// block would hide that declaration.
+class LoopOptimizer {
+public:
+  LoopOptimizer(ProgramNode &program,
+                const std::unordered_set<std::string_view> &float_variables);
+  auto run() -> void;
+  auto getHoistedCount() const -> std::size_t { return hoisted_count_; }
+
+  // statements return the statement that replaces them, a loop that had
+  // something hoisted comes back inside a block with the hidden locals
+  auto visit(Statement *statement) -> StatementPtr {
+    return visitStatement(*this, statement);
+  }
+  auto visit(InvalidStatement *statement) -> StatementPtr { return statement; }
+  auto visit(PrintStatement *statement) -> StatementPtr { return statement; }
+  auto visit(VariableDeclaration *statement) -> StatementPtr;
+  auto visit(Assignment *statement) -> StatementPtr { return statement; }
+  auto visit(BlockScope *statement) -> StatementPtr;
+  auto visit(IfStatement *statement) -> StatementPtr;
+  auto visit(WhileStatement *statement) -> StatementPtr;
+
+private:
+  ProgramNode &program_;
+  const std::unordered_set<std::string_view> &float_variables_;
+  std::size_t scope_depth_ = 0;
+  // names declared on every path to the statement being visited
+  std::unordered_set<std::string_view> declared_;
+  // numbers the hidden locals
+  std::size_t hoisted_count_ = 0;
+};
+
+#endif // !LOOP_OPTIMIZER_H
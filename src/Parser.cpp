@@ -2,26 +2,69 @@
 #include "AST.h"
 #include "Error.h"
 #include "Token.h"
-#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <format>
 #include <iostream>
-#include <memory>
 #include <ostream>
 #include <set>
+#include <span>
 
 namespace {
 const auto builtin_types =
     std::set<TokenType>{TokenType::FLOAT, TokenType::STRING, TokenType::BOOL};
-}
+
+// How tightly each infix operator binds, from least to highest. 0 means the
+// token isn't an infix operator and ends the expression.
+constexpr auto infix_power = [] {
+  auto table =
+      std::array<std::uint8_t, static_cast<std::size_t>(TokenType::INVALID) +
+                                   1>{};
+  auto set = [&](TokenType type, std::uint8_t power) {
+    table[static_cast<std::size_t>(type)] = power;
+  };
+  set(TokenType::OR, 1);
+  set(TokenType::AND, 2);
+  set(TokenType::EQUALITY, 3);
+  set(TokenType::INEQUALITY, 3);
+  set(TokenType::LESS_THAN, 4);
+  set(TokenType::LESS_THAN_OR_EQUAL, 4);
+  set(TokenType::GREATER_THAN, 4);
+  set(TokenType::GREATER_THAN_OR_EQUAL, 4);
+  set(TokenType::PLUS, 5);
+  set(TokenType::MINUS, 5);
+  set(TokenType::MUL, 6);
+  set(TokenType::DIV, 6);
+  return table;
+}();
+} // namespace
 
 Parser::Parser(std::string_view filename, const std::vector<Token> &tokens)
-    : filename_{filename}, tokens_{tokens} {}
+    : filename_{filename}, tokens_{tokens}, copy_strings_{true} {
+  result_.Strings = std::make_shared<StringInterner>();
+}
+
+Parser::Parser(SourcePtr source, const std::vector<Token> &tokens)
+    : filename_{source->getName()}, tokens_{tokens}, copy_strings_{true} {
+  result_.Source = std::move(source);
+  result_.Strings = std::make_shared<StringInterner>();
+}
+
+Parser::Parser(const CompactTokens &tokens)
+    : filename_{tokens.getSource()->getName()}, tokens_{tokens} {
+  result_.Source = tokens.getSource();
+  result_.Strings = tokens.getInterner();
+}
+
+Parser::Parser(Lexer &lexer)
+    : filename_{lexer.getSource()->getName()}, tokens_{lexer} {
+  result_.Source = lexer.getSource();
+  result_.Strings = lexer.getInterner();
+}
 
 auto Parser::parse() -> ProgramNode & {
-  // -1 is there for the EOF token
-  while (pos_ < tokens_.size() - 1) {
-    result_.Statements.push_back(std::move(parseStatement()));
+  while (peekType() != TokenType::END_OF_FILE) {
+    result_.Statements.push_back(parseStatement());
     if (is_panic_) {
       handlePanic();
     }
@@ -31,8 +74,8 @@ auto Parser::parse() -> ProgramNode & {
 }
 
 auto Parser::handlePanic() -> void {
-  while (peek().Type != TokenType::END_OF_FILE) {
-    switch (peek().Type) {
+  while (peekType() != TokenType::END_OF_FILE) {
+    switch (peekType()) {
     case TokenType::CLASS:
     case TokenType::FN:
     case TokenType::PRINT:
@@ -49,28 +92,31 @@ auto Parser::handlePanic() -> void {
 }
 
 auto Parser::expect(TokenType type, std::string_view error) -> bool {
-  const auto &curr_token = tokens_[pos_];
-  if (curr_token.Type != type) {
-    reportError(error, filename_, curr_token.Line);
+  if (peekType() != type) {
+    reportError(error, filename_, peek().Line);
     return false;
   }
   return true;
 }
 
-auto Parser::consume() -> Token {
-  ++pos_;
-  return tokens_[pos_ - 1];
+auto Parser::consume() -> const Token & { return tokens_.consume(); }
+
+auto Parser::peek(std::size_t n) -> const Token & { return tokens_.peek(n); }
+
+auto Parser::peekType(std::size_t n) -> TokenType {
+  return tokens_.peekType(n);
 }
 
-auto Parser::peek(std::size_t n) -> Token {
-  if (pos_ + n < tokens_.size()) {
-    return tokens_[pos_ + n];
+auto Parser::name(const Token &token) -> std::string_view {
+  if (result_.Source != nullptr) {
+    return token.Lexeme;
   }
-  return Token{.Type = TokenType::END_OF_FILE};
+  // nothing keeps the tokens' text alive after parsing
+  return result_.Nodes.copyString(token.Lexeme);
 }
 
 auto Parser::parseStatement() -> StatementPtr {
-  switch (peek().Type) {
+  switch (peekType()) {
   case TokenType::PRINT:
     return parsePrint();
   case TokenType::IDENTIFIER:
@@ -82,8 +128,8 @@ auto Parser::parseStatement() -> StatementPtr {
   case TokenType::WHILE:
     return parseWhileStatement();
   default: {
-    auto invalid_stmt = std::make_unique<InvalidStatement>();
-    invalid_stmt->Line = tokens_[pos_].Line; // a little lazy but close
+    auto invalid_stmt = make<InvalidStatement>();
+    invalid_stmt->Line = peek().Line; // a little lazy but close
     is_panic_ = true;
     reportError(filename_, std::format("Invalid statement {}!", peek().Lexeme),
                 invalid_stmt->Line);
@@ -92,81 +138,37 @@ auto Parser::parseStatement() -> StatementPtr {
   }
 }
 
-auto Parser::parseExpression() -> ExpressionPtr { return parseEquality(); }
-
-auto Parser::parseEquality() -> ExpressionPtr {
+auto Parser::parseExpression(std::uint8_t min_power) -> ExpressionPtr {
   // take in the left side of the operation
-  auto this_node = parseRelational();
-
-  while (pos_ < tokens_.size() && (peek().Type == TokenType::EQUALITY) ||
-         (peek().Type == TokenType::INEQUALITY)) {
+  auto this_node = parseUnary();
+  // keep folding in operators that bind at least as tight as min_power, the
+  // right side only takes the ones that bind tighter (left associative)
+  for (auto power = ::infix_power[static_cast<std::size_t>(peekType())];
+       power != 0 && power >= min_power;
+       power = ::infix_power[static_cast<std::size_t>(peekType())]) {
     const auto &this_tok = consume();
     auto op = this_tok.Type; // get that juicy operator
-    // take in the right side of the operation
-    this_node =
-        std::make_unique<BinaryOperation>(op, this_node, parseEquality());
-    this_node->Line = this_tok.Line;
-  }
-  // !NOTE: unique_ptr safely casts to base types with a converting constructor
-  return this_node;
-}
-
-auto Parser::parseRelational() -> ExpressionPtr {
-  auto this_node = parseTerm(); // left hand side
-  // all the relational operators
-  auto relational_token_types = std::array<TokenType, 4>{
-      TokenType::LESS_THAN, TokenType::LESS_THAN_OR_EQUAL,
-      TokenType::GREATER_THAN, TokenType::GREATER_THAN_OR_EQUAL};
-  // parse
-  while (pos_ < tokens_.size() &&
-         std::find(relational_token_types.begin(), relational_token_types.end(),
-                   peek().Type) != relational_token_types.end()) {
-    const auto &this_tok = consume();
-    auto op = this_tok.Type; // juicy...
-    // get the right side
-    this_node = std::make_unique<BinaryOperation>(op, this_node, parseTerm());
-    this_node->Line = this_tok.Line;
-  }
-  return this_node;
-}
-
-auto Parser::parseTerm() -> ExpressionPtr {
-  // get the left side
-  auto this_node = parseFactor();
-  // parse the other terms
-  while (pos_ < tokens_.size() &&
-         (peek().Type == TokenType::PLUS || peek().Type == TokenType::MINUS)) {
-    const auto &this_tok = consume();
-    auto op = this_tok.Type;
-    // handle the right hand side
-    this_node = std::make_unique<BinaryOperation>(op, this_node, parseFactor());
-    this_node->Line = this_tok.Line;
-  }
-  return this_node;
-}
-
-auto Parser::parseFactor() -> ExpressionPtr {
-  auto this_node = parseUnary(); // parse left
-  // parse the other factors
-  while (pos_ < tokens_.size() &&
-         (peek().Type == TokenType::MUL || peek().Type == TokenType::DIV)) {
-    const auto &this_tok = consume();
-    auto op = this_tok.Type;
-    // handle the right hand side
-    this_node = std::make_unique<BinaryOperation>(op, this_node, parseUnary());
-    this_node->Line = this_tok.Line;
+    auto line = this_tok.Line;
+    auto right = parseExpression(power + 1);
+    if (op == TokenType::AND || op == TokenType::OR) {
+      this_node = make<LogicalOperation>(op, this_node, right);
+    } else {
+      this_node = make<BinaryOperation>(op, this_node, right);
+    }
+    this_node->Line = line;
   }
   return this_node;
 }
 
 auto Parser::parseUnary() -> ExpressionPtr {
   // expect there to be a prefixed ! or - operator
-  if (peek().Type == TokenType::MINUS || peek().Type == TokenType::NOT) {
+  if (peekType() == TokenType::MINUS || peekType() == TokenType::NOT) {
     const auto &this_tok = consume();
     auto op = this_tok.Type;
-    // handle the operand
-    auto this_node = std::make_unique<UnaryOperation>(op, parsePrimary());
-    this_node->Line = this_tok.Line;
+    auto line = this_tok.Line;
+    // prefix operators bind tighter than any infix one
+    auto this_node = make<UnaryOperation>(op, parseUnary());
+    this_node->Line = line;
     return this_node;
   }
   // otherwise its a literal or grouping
@@ -174,13 +176,13 @@ auto Parser::parseUnary() -> ExpressionPtr {
 }
 
 auto Parser::parsePrimary() -> ExpressionPtr {
-  switch (peek().Type) {
+  switch (peekType()) {
   default: {
     // TODO: error handling later
     reportError(
         std::format("Expected a valid expression, got '{}'!", peek().Lexeme),
         filename_, peek().Line);
-    auto error_node = std::make_unique<InvalidExpression>();
+    auto error_node = make<InvalidExpression>();
     error_node->Line =
         consume().Line; // we consume to get rid of the offending character
     is_panic_ = true;
@@ -188,38 +190,41 @@ auto Parser::parsePrimary() -> ExpressionPtr {
   }
   case TokenType::IDENTIFIER: {
     const auto &this_tok = consume();
-    auto this_node = std::make_unique<VariableEval>(
-        this_tok.Lexeme); // store the variable name
+    auto this_node = make<VariableEval>(name(this_tok)); // the variable name
     this_node->Line = this_tok.Line;
     return this_node;
   }
   case TokenType::STRING_LITERAL: {
     const auto &this_tok = consume();
-    auto this_node = std::make_unique<Literal>(this_tok.Value);
+    auto value = this_tok.Value;
+    if (copy_strings_) {
+      value = result_.Strings->intern(std::get<InternedString>(value).view());
+    }
+    auto this_node = make<Literal>(value);
     this_node->Line = this_tok.Line;
     return this_node;
   }
   case TokenType::FLOAT_LITERAL: {
     const auto &this_tok = consume();
-    auto this_node = std::make_unique<Literal>(this_tok.Value);
+    auto this_node = make<Literal>(this_tok.Value);
     this_node->Line = this_tok.Line;
     return this_node;
   }
   case TokenType::TRUE: {
     auto line = consume().Line;
-    auto this_node = std::make_unique<Literal>(true);
+    auto this_node = make<Literal>(true);
     this_node->Line = line;
     return this_node;
   }
   case TokenType::FALSE: {
     auto line = consume().Line;
-    auto this_node = std::make_unique<Literal>(false);
+    auto this_node = make<Literal>(false);
     this_node->Line = line;
     return this_node;
   }
   case TokenType::NIL: {
     auto line = consume().Line;
-    auto this_node = std::make_unique<Literal>(Nil{});
+    auto this_node = make<Literal>(Nil{});
     this_node->Line = line;
     return this_node;
   }
@@ -229,13 +234,13 @@ auto Parser::parsePrimary() -> ExpressionPtr {
     // expect a right parenthesis
     if (expect(TokenType::R_PAREN, "Invalid Grouping expression!")) {
       consume(); // get rid of the right parenthesis
-      auto this_node = std::make_unique<Grouping>(std::move(expr));
+      auto this_node = make<Grouping>(expr);
       this_node->Line = line;
       return this_node;
     }
     // so... if you forgot your parenthesis
     consume(); // get rid of offending token.
-    auto error_node = std::make_unique<InvalidExpression>();
+    auto error_node = make<InvalidExpression>();
     error_node->Line = line;
     is_panic_ = true;
     return error_node;
@@ -248,7 +253,7 @@ auto Parser::parsePrint() -> StatementPtr {
   if (expect(TokenType::SEMICOLON,
              "[rookie mistake] Expected ';' after statement")) {
     consume(); // the ;
-    auto print_node = std::make_unique<PrintStatement>(std::move(expr));
+    auto print_node = make<PrintStatement>(expr);
     print_node->Line = line;
     return print_node;
   }
@@ -259,8 +264,7 @@ auto Parser::parsePrint() -> StatementPtr {
 // TODO: handle function calls
 auto Parser::parseIdentifier() -> StatementPtr {
   auto identifier = consume();
-  auto next = peek();
-  if (next.Type == TokenType::ASSIGNMENT) {
+  if (peekType() == TokenType::ASSIGNMENT) {
     return parseAssignment(identifier);
   }
   return parseVarDecl(identifier);
@@ -268,18 +272,18 @@ auto Parser::parseIdentifier() -> StatementPtr {
 
 auto Parser::parseVarDecl(const Token &identifier) -> StatementPtr {
   auto line = identifier.Line;
-  auto name = identifier.Lexeme;
+  auto name = this->name(identifier);
   // syntax: a: Int -> 5;
   if (!expect(TokenType::COLON, "Expected ':' after identifier.")) {
     return errorStatement(consume()); // get rid of offending (i know)
   }
   consume(); // remove :
   bool found_valid_id = false;
-  if (!::builtin_types.contains(peek().Type)) {
+  if (!::builtin_types.contains(peekType())) {
     std::cerr << "Expected a valid type after variable name.\n";
     return errorStatement(consume());
   }
-  auto type = consume().Lexeme;
+  auto type = this->name(consume());
   if (!expect(TokenType::ASSIGNMENT,
               "Expected -> after variable declaration.")) {
     return errorStatement(consume());
@@ -290,11 +294,11 @@ auto Parser::parseVarDecl(const Token &identifier) -> StatementPtr {
     return errorStatement(consume());
   }
   consume(); // get rid of ;
-  auto var_decl_stmt = std::make_unique<VariableDeclaration>();
+  auto var_decl_stmt = make<VariableDeclaration>();
   var_decl_stmt->Type = type;
   var_decl_stmt->Name = name;
   var_decl_stmt->Line = line;
-  var_decl_stmt->AssignedValue = std::move(value);
+  var_decl_stmt->AssignedValue = value;
   return var_decl_stmt;
 }
 
@@ -308,31 +312,34 @@ auto Parser::parseAssignment(const Token &identifier) -> StatementPtr {
     return errorStatement(consume());
   }
   consume(); // ->
-  auto stmt = std::make_unique<Assignment>();
+  auto stmt = make<Assignment>();
   stmt->Line = identifier.Line;
-  stmt->Name = identifier.Lexeme;
-  stmt->AssignmentValue = std::move(assigned_value);
+  stmt->Name = name(identifier);
+  stmt->AssignmentValue = assigned_value;
   return stmt;
 }
 
 auto Parser::errorStatement(const Token &token) -> StatementPtr {
-  auto invalid_stmt = std::make_unique<InvalidStatement>();
+  auto invalid_stmt = make<InvalidStatement>();
   invalid_stmt->Line = token.Line;
   return invalid_stmt;
 }
 
 auto Parser::parseBlock() -> StatementPtr {
   ++current_scope_depth_;
-  auto block = std::make_unique<BlockScope>();
+  auto block = make<BlockScope>();
   block->Line = consume().Line;
-  while (peek().Type != TokenType::END_OF_FILE &&
-         peek().Type != TokenType::R_BRACE) {
-    block->Statements.push_back(parseStatement());
+  auto statements = std::vector<StatementPtr>{};
+  while (peekType() != TokenType::END_OF_FILE &&
+         peekType() != TokenType::R_BRACE) {
+    statements.push_back(parseStatement());
     if (is_panic_) {
       --current_scope_depth_;
       return errorStatement(consume());
     }
   }
+  block->Statements =
+      result_.Nodes.copyArray(std::span<const StatementPtr>{statements});
   // increase depth of scope
   block->ScopeDepth = current_scope_depth_;
   --current_scope_depth_; // decrease the depth of scope
@@ -344,32 +351,32 @@ auto Parser::parseBlock() -> StatementPtr {
 }
 
 auto Parser::parseIfStatement() -> StatementPtr {
-  auto line = consume(); // If token
+  auto line = consume().Line; // If token
   auto cond = parseExpression();
   auto if_body = parseStatement();
   auto else_exists = false;
-  if (peek().Type == TokenType::ELSE) {
+  if (peekType() == TokenType::ELSE) {
     consume();
     else_exists = true;
   }
   auto else_body = else_exists ? parseStatement() : nullptr;
-  auto if_statement = std::make_unique<IfStatement>();
-  if_statement->Line = line.Line;
-  if_statement->IfBody = std::move(if_body);
+  auto if_statement = make<IfStatement>();
+  if_statement->Line = line;
+  if_statement->IfBody = if_body;
   if_statement->ElseBody =
-      else_exists ? decltype(if_statement->ElseBody){std::move(else_body)}
+      else_exists ? decltype(if_statement->ElseBody){else_body}
                   : decltype(if_statement->ElseBody){std::nullopt};
-  if_statement->Condition = std::move(cond);
+  if_statement->Condition = cond;
   return if_statement;
 }
 
 auto Parser::parseWhileStatement() -> StatementPtr {
-  auto line = consume(); // while token
+  auto line = consume().Line; // while token
   auto condition = parseExpression();
   auto body = parseStatement();
-  auto statement_ptr = std::make_unique<WhileStatement>();
-  statement_ptr->Condition = std::move(condition);
-  statement_ptr->Body = std::move(body);
-  statement_ptr->Line = line.Line;
+  auto statement_ptr = make<WhileStatement>();
+  statement_ptr->Condition = condition;
+  statement_ptr->Body = body;
+  statement_ptr->Line = line;
   return statement_ptr;
 }
@@ -3,30 +3,42 @@
 
 #include "AST.h"
 #include "Token.h"
+#include "TokenCursor.h"
+#include <cstdint>
 
 // AST generation device
 class Parser {
 public:
   explicit Parser(std::string_view filename, const std::vector<Token> &tokens);
+  // the resulting ProgramNode shares ownership of source
+  explicit Parser(SourcePtr source, const std::vector<Token> &tokens);
+  explicit Parser(const CompactTokens &tokens);
+  // pulls tokens out of the lexer as it goes instead of needing all of them
+  explicit Parser(Lexer &lexer);
 
   auto parse() -> ProgramNode &;
 
 private:
-  auto consume() -> Token;
-  auto peek(std::size_t n = 0) -> Token;
+  // both stay valid until the next consume()
+  auto consume() -> const Token &;
+  auto peek(std::size_t n = 0) -> const Token &;
+  // cheaper than peek(n).Type for compact token streams
+  auto peekType(std::size_t n = 0) -> TokenType;
   auto expect(TokenType type, std::string_view error) -> bool;
+  // allocates a node in the program's arena
+  template <typename T, typename... Args> auto make(Args &&...args) -> T * {
+    return result_.Nodes.make<T>(std::forward<Args>(args)...);
+  }
+  // names point into the program's source, or get copied into the arena if
+  // it doesn't have one
+  auto name(const Token &token) -> std::string_view;
   auto handlePanic() -> void;
-  // NOTE: precedence is from least to highest
-  auto parseExpression() -> ExpressionPtr;
   auto parseStatement() -> StatementPtr;
 
   // Rules for expressions
-  //  TODO: auto parseAssignment() -> ExpressionPtr;
-  //  TODO: auto parseLogical() -> ExpressionPtr {};
-  auto parseEquality() -> ExpressionPtr;
-  auto parseRelational() -> ExpressionPtr; // note: <=
-  auto parseTerm() -> ExpressionPtr;
-  auto parseFactor() -> ExpressionPtr;
+  // precedence climbing over the infix_power table in Parser.cpp, only takes
+  // operators that bind at least as tight as min_power
+  auto parseExpression(std::uint8_t min_power = 1) -> ExpressionPtr;
   auto parseUnary() -> ExpressionPtr;
   // TODO: auto parseFunctionCall();
   auto parsePrimary() -> ExpressionPtr;
@@ -42,11 +54,13 @@ private:
   auto parseWhileStatement() -> StatementPtr;
 
 private:
-  std::size_t pos_ = 0;
   bool is_panic_ = false;
   std::size_t current_scope_depth_ = 0;
   std::string filename_;
-  const std::vector<Token> &tokens_;
+  TokenCursor tokens_;
+  // a bare token vector doesn't come with its lexer's interner, so string
+  // literals get interned again into one the program owns
+  bool copy_strings_ = false;
   ProgramNode result_;
 };
 
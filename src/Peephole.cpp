@@ -0,0 +1,233 @@
+#include "Peephole.h"
+#include "Util.h"
+#include <array>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace {
+struct Pattern {
+  std::array<std::uint8_t, 3> Ops;
+  std::size_t Length;
+  // the window turns into this jump, going where its last instruction went,
+  // or goes away completely
+  std::optional<std::uint8_t> Becomes;
+};
+
+// A window only matches if nothing jumps into the middle of it. Like the
+// ConstantFolder, only true and false count as known conditions, what
+// JMP_TO_IF_FALSE does with nil is up to the VM.
+constexpr auto patterns = std::array{
+    // the branch is never taken, the condition is only there to be popped
+    Pattern{{PUSH_TRUE, JMP_TO_IF_FALSE}, 2, std::nullopt},
+    // or it always is
+    Pattern{{PUSH_FALSE, JMP_TO_IF_FALSE}, 2, JMP_TO},
+    // the jump already tests truthiness
+    Pattern{{NOT, NOT, JMP_TO_IF_FALSE}, 3, JMP_TO_IF_FALSE},
+};
+
+constexpr auto npos = std::numeric_limits<std::size_t>::max();
+
+auto isJump(std::uint8_t op) -> bool {
+  return op == JMP_TO || op == JMP_TO_IF_FALSE;
+}
+} // namespace
+
+Peephole::Peephole(Program &program, ConstantPool &constants,
+                   LineTable &lines)
+    : program_{program}, constants_{constants}, lines_{lines} {}
+
+auto Peephole::run() -> void {
+  if (!decode()) {
+    return;
+  }
+  auto old_size = program_.Bytecode.size();
+  compact();
+  while (rewrite()) {
+    compact();
+  }
+  encode();
+  removed_bytes_ = old_size - program_.Bytecode.size();
+}
+
+auto Peephole::decode() -> bool {
+  const auto &bytes = program_.Bytecode;
+  // instruction starting at each byte, to turn jump targets into instructions
+  auto index_of = std::vector<std::size_t>(bytes.size() + 1, npos);
+  for (std::size_t at = 0; at < bytes.size();) {
+    index_of[at] = code_.size();
+    auto instruction = Instruction{.Op = bytes[at], .Line = lines_.lineAt(at)};
+    ++at;
+    if (instruction.Op == PUSHC) {
+      if (at + 3 > bytes.size()) {
+        return false;
+      }
+      instruction.Constant =
+          (bytes[at] << 16) | (bytes[at + 1] << 8) | bytes[at + 2];
+      at += 3;
+      if (at < bytes.size() && isJump(bytes[at])) {
+        // the byte offset for now
+        instruction.Op = bytes[at++];
+        instruction.Target = static_cast<std::size_t>(
+            program_.Constants[instruction.Constant].Value.AsDouble);
+      }
+    }
+    code_.push_back(instruction);
+  }
+  index_of[bytes.size()] = code_.size();
+  for (auto &instruction : code_) {
+    if (!isJump(instruction.Op)) {
+      continue;
+    }
+    if (instruction.Target >= index_of.size() ||
+        index_of[instruction.Target] == npos) {
+      return false; // lands inside an instruction, leave the program alone
+    }
+    instruction.Target = index_of[instruction.Target];
+  }
+  return true;
+}
+
+auto Peephole::rewrite() -> bool {
+  auto changed = false;
+  for (std::size_t at = 0; at < code_.size(); ++at) {
+    auto &instruction = code_[at];
+    if (instruction.Dead) {
+      continue;
+    }
+    if (matchPattern(at)) {
+      changed = true;
+      continue;
+    }
+    if (!isJump(instruction.Op)) {
+      // nothing falls through these
+      if (instruction.Op == HALT) {
+        changed |= dropUnreachable(at + 1);
+      }
+      continue;
+    }
+    // going to a jump is going wherever it goes
+    for (auto hops = std::size_t{0}; hops < code_.size(); ++hops) {
+      const auto &target = code_[instruction.Target];
+      if (target.Op != JMP_TO || target.Target == instruction.Target) {
+        break;
+      }
+      instruction.Target = target.Target;
+      changed = true;
+    }
+    if (instruction.Op != JMP_TO) {
+      continue;
+    }
+    if (instruction.Target == at + 1) {
+      // it would get there anyway
+      instruction.Dead = true;
+      changed = true;
+      continue;
+    }
+    changed |= dropUnreachable(at + 1);
+  }
+  return changed;
+}
+
+auto Peephole::matchPattern(std::size_t at) -> bool {
+  for (const auto &pattern : ::patterns) {
+    if (at + pattern.Length > code_.size()) {
+      continue;
+    }
+    auto matches = true;
+    for (std::size_t i = 0; i < pattern.Length && matches; ++i) {
+      const auto &instruction = code_[at + i];
+      matches = !instruction.Dead && instruction.Op == pattern.Ops[i] &&
+                (i == 0 || incoming_[at + i] == 0);
+    }
+    if (!matches) {
+      continue;
+    }
+    // jumps into the window now land on whatever replaces it
+    auto last = code_[at + pattern.Length - 1];
+    for (std::size_t i = 1; i < pattern.Length; ++i) {
+      code_[at + i].Dead = true;
+    }
+    if (pattern.Becomes.has_value()) {
+      code_[at] = Instruction{
+          .Op = *pattern.Becomes, .Target = last.Target, .Line = last.Line};
+    } else {
+      code_[at].Dead = true;
+    }
+    return true;
+  }
+  return false;
+}
+
+auto Peephole::dropUnreachable(std::size_t from) -> bool {
+  auto dropped = false;
+  // the final HALT stays so there is always something to land on
+  for (auto at = from; at < code_.size() && incoming_[at] == 0 &&
+                       code_[at].Op != HALT;
+       ++at) {
+    dropped |= !code_[at].Dead;
+    code_[at].Dead = true;
+  }
+  return dropped;
+}
+
+auto Peephole::compact() -> void {
+  // a dead instruction's jumps go to the next live one instead
+  auto new_index = std::vector<std::size_t>(code_.size() + 1);
+  auto live = std::size_t{0};
+  for (std::size_t at = 0; at < code_.size(); ++at) {
+    new_index[at] = live;
+    live += code_[at].Dead ? 0 : 1;
+  }
+  new_index[code_.size()] = live;
+  std::erase_if(code_, [](const Instruction &instruction) {
+    return instruction.Dead;
+  });
+  incoming_.assign(code_.size() + 1, 0);
+  for (auto &instruction : code_) {
+    if (isJump(instruction.Op)) {
+      instruction.Target = new_index[instruction.Target];
+      ++incoming_[instruction.Target];
+    }
+  }
+}
+
+auto Peephole::encode() -> void {
+  auto offsets = std::vector<std::size_t>(code_.size() + 1);
+  auto size = std::size_t{0};
+  for (std::size_t at = 0; at < code_.size(); ++at) {
+    offsets[at] = size;
+    // PUSHC <3 byte constant> [jump]
+    size += isJump(code_[at].Op) ? 5 : code_[at].Op == PUSHC ? 4 : 1;
+  }
+  offsets[code_.size()] = size;
+
+  auto bytes = std::vector<std::uint8_t>{};
+  auto lines = LineTable{};
+  bytes.reserve(size);
+  auto push = [&](std::uint8_t byte, std::size_t line) {
+    bytes.push_back(byte);
+    lines.append(line);
+  };
+  for (const auto &instruction : code_) {
+    auto constant = instruction.Constant;
+    if (isJump(instruction.Op)) {
+      constant = constants_.addDouble(
+          static_cast<double>(offsets[instruction.Target]));
+    }
+    if (constant == -1) {
+      push(instruction.Op, instruction.Line);
+      continue;
+    }
+    auto indices = sizeToTriByte(constant);
+    push(PUSHC, instruction.Line);
+    push(std::get<0>(indices), instruction.Line);
+    push(std::get<1>(indices), instruction.Line);
+    push(std::get<2>(indices), instruction.Line);
+    if (isJump(instruction.Op)) {
+      push(instruction.Op, instruction.Line);
+    }
+  }
+  program_.Bytecode = std::move(bytes);
+  lines_ = std::move(lines);
+}
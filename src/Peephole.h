@@ -0,0 +1,54 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "ConstantPool.h"
+#include "LineTable.h"
+#include "Program.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cleans up the finished bytecode (after wrapUp). Decodes it into
+// instructions, with a PUSHC <target> JMP_TO/JMP_TO_IF_FALSE pair becoming a
+// single jump, rewrites them until nothing matches and lays the bytes back
+// out, giving every jump its new target and every byte its old line in a
+// new LineTable.
+class Peephole {
+public:
+  Peephole(Program &program, ConstantPool &constants, LineTable &lines);
+  auto run() -> void;
+  auto getRemovedBytes() const -> std::size_t { return removed_bytes_; }
+
+private:
+  struct Instruction {
+    std::uint8_t Op;
+    // constant index of a PUSHC
+    int Constant = -1;
+    // instruction index a jump goes to
+    std::size_t Target = 0;
+    std::size_t Line = 0;
+    bool Dead = false;
+  };
+
+  // false if the bytes aren't something CodeGen would have made
+  auto decode() -> bool;
+  // one sweep over the code, true if anything changed
+  auto rewrite() -> bool;
+  auto matchPattern(std::size_t at) -> bool;
+  // kills everything from `from` up to the next jump target
+  auto dropUnreachable(std::size_t from) -> bool;
+  // drops dead instructions and points jumps at the ones that took their place
+  auto compact() -> void;
+  auto encode() -> void;
+
+private:
+  Program &program_;
+  ConstantPool &constants_;
+  LineTable &lines_;
+  std::vector<Instruction> code_;
+  // how many jumps land on each instruction
+  std::vector<std::size_t> incoming_;
+  std::size_t removed_bytes_ = 0;
+};
+
+#endif // !PEEPHOLE_H
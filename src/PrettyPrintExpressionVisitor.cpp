@@ -1,27 +1,31 @@
 #include "PrettyPrintExpressionVisitor.h"
 #include <iostream>
 
-auto PrettyPrintExpressionVisitor::visit(Expression *node) -> void {
-  std::cout << "unknown expression node";
+auto PrettyPrintExpressionVisitor::visit(BinaryOperation *node) -> void {
+  std::cout << "(";
+  visit(node->Left);
+  std::cout << " " << toString(node->Operator) << " ";
+  visit(node->Right);
+  std::cout << ")";
 }
 
-auto PrettyPrintExpressionVisitor::visit(BinaryOperation *node) -> void {
+auto PrettyPrintExpressionVisitor::visit(LogicalOperation *node) -> void {
   std::cout << "(";
-  node->Left->acceptVisitor(this);
+  visit(node->Left);
   std::cout << " " << toString(node->Operator) << " ";
-  node->Right->acceptVisitor(this);
+  visit(node->Right);
   std::cout << ")";
 }
 
 auto PrettyPrintExpressionVisitor::visit(UnaryOperation *node) -> void {
   std::cout << "(" << toString(node->Operator) << " ";
-  node->Right->acceptVisitor(this);
+  visit(node->Right);
   std::cout << ")";
 }
 
 auto PrettyPrintExpressionVisitor::visit(Grouping *node) -> void {
   std::cout << "(";
-  node->Expr->acceptVisitor(this);
+  visit(node->Expr);
   std::cout << ")";
 }
 
@@ -31,7 +35,7 @@ auto PrettyPrintExpressionVisitor::visit(Literal *node) -> void {
     std::cout << ((std::get<bool>(node->Value)) ? "true" : "false");
     break;
   case LiteralVariantType::STRING:
-    std::cout << std::get<std::string>(node->Value);
+    std::cout << std::get<InternedString>(node->Value).view();
     break;
   case LiteralVariantType::DOUBLE:
     std::cout << std::get<double>(node->Value);
@@ -41,6 +45,10 @@ auto PrettyPrintExpressionVisitor::visit(Literal *node) -> void {
   }
 }
 
+auto PrettyPrintExpressionVisitor::visit(VariableEval *node) -> void {
+  std::cout << node->Name;
+}
+
 auto PrettyPrintExpressionVisitor::visit(InvalidExpression *node) -> void {
   std::cout << "(INVALID)";
 }
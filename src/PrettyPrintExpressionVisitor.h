@@ -3,17 +3,19 @@
 
 #include "AST.h"
 
-class PrettyPrintExpressionVisitor : public NodeVisitor {
+class PrettyPrintExpressionVisitor {
 public:
   PrettyPrintExpressionVisitor() = default;
-  auto visit(Expression *node) -> void override;
+  auto visit(Expression *node) -> void { visitExpression(*this, node); }
 
-  auto visit(BinaryOperation *node) -> void override;
-  auto visit(UnaryOperation *node) -> void override;
-  auto visit(Grouping *node) -> void override;
-  auto visit(Literal *node) -> void override;
+  auto visit(BinaryOperation *node) -> void;
+  auto visit(LogicalOperation *node) -> void;
+  auto visit(UnaryOperation *node) -> void;
+  auto visit(Grouping *node) -> void;
+  auto visit(Literal *node) -> void;
+  auto visit(VariableEval *node) -> void;
 
-  auto visit(InvalidExpression *node) -> void override;
+  auto visit(InvalidExpression *node) -> void;
 };
 
 #endif // !AST_EXPRESSION_PRINTER_H
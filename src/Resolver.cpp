@@ -0,0 +1,106 @@
+#include "Resolver.h"
+#include "Error.h"
+#include <format>
+
+Resolver::Resolver(ProgramNode &program) : program_{program} {}
+
+auto Resolver::run() -> void {
+  for (auto *statement : program_.Statements) {
+    visit(statement);
+  }
+}
+
+auto Resolver::visit(PrintStatement *statement) -> void {
+  visit(statement->Expr);
+}
+
+auto Resolver::visit(VariableDeclaration *statement) -> void {
+  // the value can't see the variable it initializes
+  visit(statement->AssignedValue);
+  if (scopes_.empty()) {
+    // declaring a global again just reuses it
+    auto [it, inserted] = globals_.try_emplace(
+        statement->Name, static_cast<std::uint32_t>(globals_.size()));
+    statement->Target = {.Kind = SlotKind::Global, .Index = it->second};
+    return;
+  }
+  if (lookup(statement->Name).Kind != SlotKind::Unresolved) {
+    // we already have this variable in a global or local scope
+    error("Cannot have duplicate variable!", statement->Line);
+    return;
+  }
+  scopes_.back().emplace(statement->Name, local_count_);
+  statement->Target = {.Kind = SlotKind::Local, .Index = local_count_++};
+}
+
+auto Resolver::visit(Assignment *statement) -> void {
+  visit(statement->AssignmentValue);
+  statement->Target = lookup(statement->Name);
+  if (statement->Target.Kind == SlotKind::Unresolved) {
+    error(std::format("Cannot find variable {}!", statement->Name),
+          statement->Line);
+  }
+}
+
+auto Resolver::visit(BlockScope *statement) -> void {
+  scopes_.emplace_back();
+  for (auto *child : statement->Statements) {
+    visit(child);
+  }
+  statement->LocalCount = scopes_.back().size();
+  local_count_ -= static_cast<std::uint32_t>(statement->LocalCount);
+  scopes_.pop_back();
+}
+
+auto Resolver::visit(IfStatement *statement) -> void {
+  visit(statement->Condition);
+  visit(statement->IfBody);
+  if (statement->ElseBody.has_value()) {
+    visit(*statement->ElseBody);
+  }
+}
+
+auto Resolver::visit(WhileStatement *statement) -> void {
+  visit(statement->Condition);
+  visit(statement->Body);
+}
+
+auto Resolver::visit(BinaryOperation *node) -> void {
+  visit(node->Left);
+  visit(node->Right);
+}
+
+auto Resolver::visit(LogicalOperation *node) -> void {
+  visit(node->Left);
+  visit(node->Right);
+}
+
+auto Resolver::visit(UnaryOperation *node) -> void { visit(node->Right); }
+
+auto Resolver::visit(Grouping *node) -> void { visit(node->Expr); }
+
+auto Resolver::visit(VariableEval *node) -> void {
+  node->Target = lookup(node->Name);
+  if (node->Target.Kind == SlotKind::Unresolved) {
+    error(std::format("Could not find variable {}!", node->Name), node->Line);
+  }
+}
+
+auto Resolver::lookup(std::string_view name) const -> Slot {
+  for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+    if (auto it = scope->find(name); it != scope->end()) {
+      return {.Kind = SlotKind::Local, .Index = it->second};
+    }
+  }
+  if (auto it = globals_.find(name); it != globals_.end()) {
+    return {.Kind = SlotKind::Global, .Index = it->second};
+  }
+  return {};
+}
+
+auto Resolver::error(std::string_view message, std::size_t line) -> void {
+  ++error_count_;
+  auto filename =
+      program_.Source != nullptr ? program_.Source->getName() : "";
+  reportError(message, filename, line);
+}
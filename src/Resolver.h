@@ -0,0 +1,54 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "AST.h"
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Binds every variable to a local stack slot or a global before CodeGen, so
+// code generation never looks a name up. Walks the tree once with a hash table
+// per open block and reports undefined and duplicate variables.
+class Resolver {
+public:
+  explicit Resolver(ProgramNode &program);
+  auto run() -> void;
+  auto getErrorCount() const -> std::size_t { return error_count_; }
+  // globals are numbered 0..getGlobalCount() - 1 in declaration order
+  auto getGlobalCount() const -> std::size_t { return globals_.size(); }
+
+  auto visit(Statement *statement) -> void { visitStatement(*this, statement); }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void;
+  auto visit(VariableDeclaration *statement) -> void;
+  auto visit(Assignment *statement) -> void;
+  auto visit(BlockScope *statement) -> void;
+  auto visit(IfStatement *statement) -> void;
+  auto visit(WhileStatement *statement) -> void;
+
+  auto visit(Expression *node) -> void { visitExpression(*this, node); }
+  auto visit(BinaryOperation *node) -> void;
+  auto visit(LogicalOperation *node) -> void;
+  auto visit(UnaryOperation *node) -> void;
+  auto visit(Grouping *node) -> void;
+  auto visit(Literal *node) -> void {}
+  auto visit(VariableEval *node) -> void;
+  auto visit(InvalidExpression *node) -> void {}
+
+private:
+  // innermost local first, then globals. Unresolved if neither has it.
+  auto lookup(std::string_view name) const -> Slot;
+  auto error(std::string_view message, std::size_t line) -> void;
+
+private:
+  ProgramNode &program_;
+  // one table per open block, innermost last
+  std::vector<std::unordered_map<std::string_view, std::uint32_t>> scopes_;
+  // locals currently on the stack, which is also the next local's slot
+  std::uint32_t local_count_ = 0;
+  std::unordered_map<std::string_view, std::uint32_t> globals_;
+  std::size_t error_count_ = 0;
+};
+
+#endif // !RESOLVER_H
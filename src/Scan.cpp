@@ -0,0 +1,332 @@
+#include "Scan.h"
+#include <bit>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VORTEX_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+struct ScanKernels {
+  ScanMode Mode;
+  auto (*Whitespace)(std::string_view, std::size_t, std::size_t &)
+      -> std::size_t;
+  auto (*ToNewline)(std::string_view, std::size_t) -> std::size_t;
+  auto (*ToQuote)(std::string_view, std::size_t, std::size_t &) -> std::size_t;
+  auto (*Identifier)(std::string_view, std::size_t) -> std::size_t;
+};
+
+// ---------------------------------------------------------------------------
+// scalar reference, also used for the tails of the vector kernels
+
+auto isBlank(char ch) -> bool {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+auto isIdentifierChar(char ch) -> bool {
+  return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+         (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+auto whitespaceScalar(std::string_view text, std::size_t pos,
+                      std::size_t &line) -> std::size_t {
+  while (pos < text.size() && isBlank(text[pos])) {
+    line += text[pos] == '\n';
+    ++pos;
+  }
+  return pos;
+}
+
+auto toNewlineScalar(std::string_view text, std::size_t pos) -> std::size_t {
+  while (pos < text.size() && text[pos] != '\n') {
+    ++pos;
+  }
+  return pos;
+}
+
+auto toQuoteScalar(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  while (pos < text.size() && text[pos] != '"') {
+    line += text[pos] == '\n';
+    ++pos;
+  }
+  return pos;
+}
+
+auto identifierScalar(std::string_view text, std::size_t pos) -> std::size_t {
+  while (pos < text.size() && isIdentifierChar(text[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+constexpr auto scalar_kernels =
+    ScanKernels{ScanMode::Scalar, whitespaceScalar, toNewlineScalar,
+                toQuoteScalar, identifierScalar};
+
+#ifdef VORTEX_SCAN_X86
+// bits below the first set bit of stop, i.e. the lanes before the stop lane
+auto lanesBefore(std::uint32_t stop) -> std::uint32_t {
+  return (stop & (0u - stop)) - 1u;
+}
+
+// ---------------------------------------------------------------------------
+// SSE2, 16 bytes per step. Signed compares are fine for the ranges below since
+// bytes >= 0x80 come out negative and never match.
+
+__attribute__((target("sse2"))) auto sse2Blank(__m128i chunk) -> __m128i {
+  auto blank = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')));
+  blank = _mm_or_si128(blank, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+  return _mm_or_si128(blank, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+}
+
+__attribute__((target("sse2"))) auto sse2InRange(__m128i chunk, char low,
+                                                  char high) -> __m128i {
+  return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), chunk));
+}
+
+__attribute__((target("sse2"))) auto
+whitespaceSSE2(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 16 <= text.size(); pos += 16) {
+    auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    auto newlines = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+    auto stop = ~static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(sse2Blank(chunk))) &
+                0xFFFFu;
+    if (stop != 0) {
+      line += std::popcount(newlines & lanesBefore(stop));
+      return pos + std::countr_zero(stop);
+    }
+    line += std::popcount(newlines);
+  }
+  return whitespaceScalar(text, pos, line);
+}
+
+__attribute__((target("sse2"))) auto toNewlineSSE2(std::string_view text,
+                                                    std::size_t pos)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 16 <= text.size(); pos += 16) {
+    auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    auto stop = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+    if (stop != 0) {
+      return pos + std::countr_zero(stop);
+    }
+  }
+  return toNewlineScalar(text, pos);
+}
+
+__attribute__((target("sse2"))) auto
+toQuoteSSE2(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 16 <= text.size(); pos += 16) {
+    auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    auto newlines = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+    auto stop = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))));
+    if (stop != 0) {
+      line += std::popcount(newlines & lanesBefore(stop));
+      return pos + std::countr_zero(stop);
+    }
+    line += std::popcount(newlines);
+  }
+  return toQuoteScalar(text, pos, line);
+}
+
+__attribute__((target("sse2"))) auto identifierSSE2(std::string_view text,
+                                                     std::size_t pos)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 16 <= text.size(); pos += 16) {
+    auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    // folding to lower case only matters for the letter range check
+    auto lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    auto word = _mm_or_si128(sse2InRange(lower, 'a', 'z'),
+                             sse2InRange(chunk, '0', '9'));
+    word = _mm_or_si128(word, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+    auto stop =
+        ~static_cast<std::uint32_t>(_mm_movemask_epi8(word)) & 0xFFFFu;
+    if (stop != 0) {
+      return pos + std::countr_zero(stop);
+    }
+  }
+  return identifierScalar(text, pos);
+}
+
+constexpr auto sse2_kernels = ScanKernels{ScanMode::SSE2, whitespaceSSE2,
+                                          toNewlineSSE2, toQuoteSSE2,
+                                          identifierSSE2};
+
+// ---------------------------------------------------------------------------
+// AVX2, same as above but 32 bytes per step
+
+__attribute__((target("avx2"))) auto avx2Blank(__m256i chunk) -> __m256i {
+  auto blank =
+      _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                      _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')));
+  blank =
+      _mm256_or_si256(blank, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+  return _mm256_or_si256(blank,
+                         _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+}
+
+__attribute__((target("avx2"))) auto avx2InRange(__m256i chunk, char low,
+                                                  char high) -> __m256i {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(low - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chunk));
+}
+
+__attribute__((target("avx2"))) auto
+whitespaceAVX2(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 32 <= text.size(); pos += 32) {
+    auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    auto newlines = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+    auto stop =
+        ~static_cast<std::uint32_t>(_mm256_movemask_epi8(avx2Blank(chunk)));
+    if (stop != 0) {
+      line += std::popcount(newlines & lanesBefore(stop));
+      return pos + std::countr_zero(stop);
+    }
+    line += std::popcount(newlines);
+  }
+  return whitespaceSSE2(text, pos, line);
+}
+
+__attribute__((target("avx2"))) auto toNewlineAVX2(std::string_view text,
+                                                    std::size_t pos)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 32 <= text.size(); pos += 32) {
+    auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    auto stop = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+    if (stop != 0) {
+      return pos + std::countr_zero(stop);
+    }
+  }
+  return toNewlineSSE2(text, pos);
+}
+
+__attribute__((target("avx2"))) auto
+toQuoteAVX2(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 32 <= text.size(); pos += 32) {
+    auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    auto newlines = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+    auto stop = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))));
+    if (stop != 0) {
+      line += std::popcount(newlines & lanesBefore(stop));
+      return pos + std::countr_zero(stop);
+    }
+    line += std::popcount(newlines);
+  }
+  return toQuoteSSE2(text, pos, line);
+}
+
+__attribute__((target("avx2"))) auto identifierAVX2(std::string_view text,
+                                                     std::size_t pos)
+    -> std::size_t {
+  const auto *data = text.data();
+  for (; pos + 32 <= text.size(); pos += 32) {
+    auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+    auto lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    auto word = _mm256_or_si256(avx2InRange(lower, 'a', 'z'),
+                                avx2InRange(chunk, '0', '9'));
+    word = _mm256_or_si256(word,
+                           _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+    auto stop = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(word));
+    if (stop != 0) {
+      return pos + std::countr_zero(stop);
+    }
+  }
+  return identifierSSE2(text, pos);
+}
+
+constexpr auto avx2_kernels = ScanKernels{ScanMode::AVX2, whitespaceAVX2,
+                                          toNewlineAVX2, toQuoteAVX2,
+                                          identifierAVX2};
+#endif // VORTEX_SCAN_X86
+
+auto kernelsFor(ScanMode mode) -> const ScanKernels * {
+  switch (mode) {
+  case ScanMode::Auto:
+#ifdef VORTEX_SCAN_X86
+    if (__builtin_cpu_supports("avx2")) {
+      return &avx2_kernels;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      return &sse2_kernels;
+    }
+#endif
+    return &scalar_kernels;
+  case ScanMode::Scalar:
+    return &scalar_kernels;
+#ifdef VORTEX_SCAN_X86
+  case ScanMode::SSE2:
+    return __builtin_cpu_supports("sse2") ? &sse2_kernels : nullptr;
+  case ScanMode::AVX2:
+    return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+auto active() -> const ScanKernels *& {
+  static auto *kernels = kernelsFor(ScanMode::Auto);
+  return kernels;
+}
+} // namespace
+
+auto setScanMode(ScanMode mode) -> bool {
+  const auto *kernels = kernelsFor(mode);
+  if (kernels == nullptr) {
+    return false;
+  }
+  active() = kernels;
+  return true;
+}
+
+auto getScanMode() -> ScanMode { return active()->Mode; }
+
+auto scanWhitespace(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  return active()->Whitespace(text, pos, line);
+}
+
+auto scanToNewline(std::string_view text, std::size_t pos) -> std::size_t {
+  return active()->ToNewline(text, pos);
+}
+
+auto scanToQuote(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t {
+  return active()->ToQuote(text, pos, line);
+}
+
+auto scanIdentifier(std::string_view text, std::size_t pos) -> std::size_t {
+  return active()->Identifier(text, pos);
+}
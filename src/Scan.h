@@ -0,0 +1,32 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <string_view>
+
+// Bulk scanning loops for the lexer. Each kernel starts at pos and returns the
+// index of the first byte it stops on (or text.size()). The vector versions
+// look at 16 (SSE2) or 32 (AVX2) bytes at a time.
+
+enum class ScanMode { Auto, Scalar, SSE2, AVX2 };
+
+// selects the kernels used by every lexer. Auto picks the widest one the cpu
+// supports, Scalar is the byte at a time reference the vector kernels are
+// tested against. Returns false (and changes nothing) if the cpu can't run the
+// requested mode. Not thread safe, call it before lexing.
+auto setScanMode(ScanMode mode) -> bool;
+// the mode that's actually in use (never Auto)
+auto getScanMode() -> ScanMode;
+
+// skips ' ', '\t', '\r' and '\n', adding the newlines it passes to line
+auto scanWhitespace(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t;
+// finds the next '\n' (end of a # comment)
+auto scanToNewline(std::string_view text, std::size_t pos) -> std::size_t;
+// finds the next '"', adding the newlines it passes to line
+auto scanToQuote(std::string_view text, std::size_t pos, std::size_t &line)
+    -> std::size_t;
+// skips [A-Za-z0-9_]
+auto scanIdentifier(std::string_view text, std::size_t pos) -> std::size_t;
+
+#endif // !SCAN_H
@@ -0,0 +1,141 @@
+#include "Source.h"
+#include "Error.h"
+#include <cassert>
+#include <format>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define VORTEX_HAS_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iostream>
+#endif
+
+namespace {
+// read size for files we can't map
+constexpr auto stream_chunk_size = std::size_t{64 * 1024};
+} // namespace
+
+SourceFile::~SourceFile() {
+#ifdef VORTEX_HAS_MMAP
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+#endif
+}
+
+auto SourceFile::fromString(std::string_view text, std::string_view name)
+    -> std::shared_ptr<const SourceFile> {
+  auto source = std::shared_ptr<SourceFile>{new SourceFile{}};
+  source->name_ = name;
+  source->storage_ = text;
+  source->text_ = source->storage_;
+  return source;
+}
+
+auto SourceFile::withEdit(const TextEdit &edit) const
+    -> std::shared_ptr<const SourceFile> {
+  assert(edit.Offset + edit.RemovedLength <= text_.size() &&
+         "edit past the end of the file");
+  auto text = std::string{};
+  text.reserve(text_.size() - edit.RemovedLength + edit.Inserted.size());
+  text += text_.substr(0, edit.Offset);
+  text += edit.Inserted;
+  text += text_.substr(edit.Offset + edit.RemovedLength);
+  auto source = std::shared_ptr<SourceFile>{new SourceFile{}};
+  source->name_ = name_;
+  source->storage_ = std::move(text);
+  source->text_ = source->storage_;
+  return source;
+}
+
+#ifdef VORTEX_HAS_MMAP
+auto SourceFile::fromPath(const std::string &path)
+    -> std::shared_ptr<const SourceFile> {
+  auto source = std::shared_ptr<SourceFile>{new SourceFile{}};
+  source->name_ = path;
+  if (path == "-") {
+    source->name_ = "<stdin>";
+    if (!source->readStream(STDIN_FILENO)) {
+      reportError("Could not read source from stdin!");
+      return nullptr;
+    }
+    return source;
+  }
+
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    reportError(std::format("Could not open source file '{}'!", path));
+    return nullptr;
+  }
+  struct stat info {};
+  auto ok = fstat(fd, &info) == 0;
+  if (ok && S_ISREG(info.st_mode) && info.st_size > 0) {
+    auto size = static_cast<std::size_t>(info.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      // the lexer walks the file front to back exactly once
+      madvise(mapping, size, MADV_SEQUENTIAL);
+      source->mapping_ = mapping;
+      source->mapping_size_ = size;
+      source->text_ = {static_cast<const char *>(mapping), size};
+      close(fd);
+      return source;
+    }
+  }
+  // pipes, fifos, empty files or a failed mapping
+  ok = ok && source->readStream(fd);
+  close(fd);
+  if (!ok) {
+    reportError(std::format("Could not read source file '{}'!", path));
+    return nullptr;
+  }
+  return source;
+}
+
+auto SourceFile::readStream(int fd) -> bool {
+  auto size = std::size_t{0};
+  while (true) {
+    storage_.resize(size + stream_chunk_size);
+    auto count = read(fd, storage_.data() + size, stream_chunk_size);
+    if (count == 0) {
+      break;
+    }
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    size += static_cast<std::size_t>(count);
+  }
+  storage_.resize(size);
+  text_ = storage_;
+  return true;
+}
+#else
+auto SourceFile::fromPath(const std::string &path)
+    -> std::shared_ptr<const SourceFile> {
+  auto source = std::shared_ptr<SourceFile>{new SourceFile{}};
+  source->name_ = path == "-" ? "<stdin>" : path;
+  auto file = std::ifstream{};
+  if (path != "-") {
+    file.open(path, std::ios_base::in | std::ios_base::binary);
+    if (!file) {
+      reportError(std::format("Could not open source file '{}'!", path));
+      return nullptr;
+    }
+  }
+  auto &in = path == "-" ? std::cin : static_cast<std::istream &>(file);
+  auto chunk = std::string(stream_chunk_size, '\0');
+  while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0) {
+    source->storage_.append(chunk.data(), in.gcount());
+  }
+  source->text_ = source->storage_;
+  return source;
+}
+#endif
@@ -0,0 +1,55 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Replaces RemovedLength bytes at Offset with Inserted
+struct TextEdit {
+  std::size_t Offset;
+  std::size_t RemovedLength;
+  std::string_view Inserted;
+};
+
+// The immutable text of one vortex file. Tokens and AST nodes only hold views
+// into this buffer, so it is shared (not copied) between the lexer, parser and
+// code generator and stays alive for as long as any of them need it.
+class SourceFile {
+public:
+  static auto fromString(std::string_view text, std::string_view name)
+      -> std::shared_ptr<const SourceFile>;
+  // maps regular files straight into memory, anything else (pipes, "-" for
+  // stdin) gets streamed in chunks. Reports an error and returns nullptr if
+  // the file can't be read.
+  static auto fromPath(const std::string &path)
+      -> std::shared_ptr<const SourceFile>;
+
+  // a copy of this file (same name) with the edit applied
+  auto withEdit(const TextEdit &edit) const
+      -> std::shared_ptr<const SourceFile>;
+
+  SourceFile(const SourceFile &) = delete;
+  auto operator=(const SourceFile &) -> SourceFile & = delete;
+  ~SourceFile();
+
+  auto getText() const -> std::string_view { return text_; }
+  auto getName() const -> std::string_view { return name_; }
+
+private:
+  SourceFile() = default;
+  // appends everything until EOF to storage_ (posix only)
+  auto readStream(int fd) -> bool;
+
+private:
+  std::string name_;
+  std::string storage_;
+  std::string_view text_;
+  // non null when text_ is a read-only mapping of the file
+  void *mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+};
+
+using SourcePtr = std::shared_ptr<const SourceFile>;
+
+#endif // !SOURCE_H
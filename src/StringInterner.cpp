@@ -0,0 +1,12 @@
+#include "StringInterner.h"
+
+auto StringInterner::intern(std::string_view text) -> InternedString {
+  auto hash = std::hash<std::string_view>{}(text);
+  if (auto it = lookup_.find(Key{hash, text}); it != lookup_.end()) {
+    return InternedString{it->second};
+  }
+  const auto &entry = entries_.emplace_back(
+      InternedEntry{.Hash = hash, .Text = std::string{text}});
+  lookup_.emplace(Key{hash, entry.Text}, &entry);
+  return InternedString{&entry};
+}
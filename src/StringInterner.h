@@ -0,0 +1,69 @@
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct InternedEntry {
+  std::size_t Hash;
+  std::string Text;
+};
+
+// Handle to a string owned by a StringInterner. Two handles from the same
+// interner are equal exactly when they point at the same entry, so comparing
+// (and hashing) them never looks at the characters.
+class InternedString {
+public:
+  InternedString() = default;
+  explicit InternedString(const InternedEntry *entry) : entry_{entry} {}
+
+  auto view() const -> std::string_view { return entry_->Text; }
+  auto getHash() const -> std::size_t { return entry_->Hash; }
+  auto operator==(const InternedString &other) const -> bool = default;
+
+private:
+  const InternedEntry *entry_ = nullptr;
+};
+
+template <> struct std::hash<InternedString> {
+  auto operator()(const InternedString &str) const -> std::size_t {
+    return str.getHash();
+  }
+};
+
+// Keeps one copy of every distinct string it is given. Shared (through
+// InternerPtr) by everything that holds InternedStrings: the lexer, the AST
+// and the code generator.
+class StringInterner {
+public:
+  auto intern(std::string_view text) -> InternedString;
+  auto size() const -> std::size_t { return entries_.size(); }
+
+private:
+  // lookup key that carries its hash, so each string is only hashed once
+  struct Key {
+    std::size_t Hash;
+    std::string_view Text;
+    auto operator==(const Key &other) const -> bool {
+      return Text == other.Text;
+    }
+  };
+  struct KeyHash {
+    auto operator()(const Key &key) const -> std::size_t { return key.Hash; }
+  };
+
+private:
+  // a deque never moves its elements, so handles and the views used as keys
+  // below stay valid as it grows
+  std::deque<InternedEntry> entries_;
+  std::unordered_map<Key, const InternedEntry *, KeyHash> lookup_;
+};
+
+using InternerPtr = std::shared_ptr<StringInterner>;
+
+#endif // !STRING_INTERNER_H
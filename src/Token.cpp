@@ -149,29 +149,33 @@ auto toString(TokenType type) -> std::string {
   return ss.str();
 }
 
+auto prettyPrint(std::ostream &stream, const Token &tok) -> void {
+  // print out the type
+  auto token_typename = toString(tok.Type);
+  stream << "[TYPE: " << token_typename << "]; ";
+  auto token_index = tok.Value.index();
+  // print out the literal value
+  switch (LiteralVariantType{token_index}) {
+  case LiteralVariantType::NIL:
+    stream << "[Value: NIL]; ";
+    break;
+  case LiteralVariantType::DOUBLE:
+    stream << "[Value: " << std::get<double>(tok.Value) << "]; ";
+    break;
+  case LiteralVariantType::STRING:
+    stream << "[Value: " << std::get<InternedString>(tok.Value).view() << "]; ";
+    break;
+  case LiteralVariantType::BOOL:
+    stream << "[Value: " << std::boolalpha << std::get<bool>(tok.Value)
+           << "]; ";
+    break;
+  }
+  stream << "[LINE: " << tok.Line << "]; [Lexeme: {" << tok.Lexeme << "}];\n";
+}
+
 auto prettyPrint(std::ostream &stream,
                  const std::vector<Token> &tokens) -> void {
   for (auto &tok : tokens) {
-    // print out the type
-    auto token_typename = toString(tok.Type);
-    stream << "[TYPE: " << token_typename << "]; ";
-    auto token_index = tok.Value.index();
-    // print out the literal value
-    switch (LiteralVariantType{token_index}) {
-    case LiteralVariantType::NIL:
-      stream << "[Value: NIL]; ";
-      break;
-    case LiteralVariantType::DOUBLE:
-      stream << "[Value: " << std::get<double>(tok.Value) << "]; ";
-      break;
-    case LiteralVariantType::STRING:
-      stream << "[Value: " << std::get<std::string>(tok.Value) << "]; ";
-      break;
-    case LiteralVariantType::BOOL:
-      stream << "[Value: " << std::boolalpha << std::get<bool>(tok.Value)
-             << "]; ";
-      break;
-    }
-    stream << "[LINE: " << tok.Line << "]; [Lexeme: {" << tok.Lexeme << "}];\n";
+    prettyPrint(stream, tok);
   }
 }
@@ -1,7 +1,9 @@
 #ifndef TOKEN_H
 #define TOKEN_H
+#include "StringInterner.h"
 #include "Util.h"
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -68,18 +70,21 @@ enum class TokenType {
 
 enum class LiteralVariantType : std::size_t { NIL = 0, STRING, DOUBLE, BOOL };
 
-using LiteralVariant = std::variant<None, std::string, double, bool>;
+// strings are interned, so equal literals share one InternedString
+using LiteralVariant = std::variant<None, InternedString, double, bool>;
 // changed my mind but don't wanna break code.
 using Nil = None;
 
+// Lexeme is a view into the SourceFile the token was lexed from
 struct Token {
-  std::string Lexeme;
+  std::string_view Lexeme;
   std::size_t Line;
   LiteralVariant Value;
   TokenType Type;
 };
 
 auto toString(TokenType type) -> std::string;
+auto prettyPrint(std::ostream &stream, const Token &token) -> void;
 auto prettyPrint(std::ostream &stream,
                  const std::vector<Token> &tokens) -> void;
 
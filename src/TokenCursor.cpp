@@ -0,0 +1,73 @@
+#include "TokenCursor.h"
+#include <cassert>
+
+TokenCursor::TokenCursor(const std::vector<Token> &tokens) : tokens_{&tokens} {
+  eof_.Line = tokens.empty() ? 0 : tokens.back().Line;
+}
+
+TokenCursor::TokenCursor(const CompactTokens &tokens) : compact_{&tokens} {}
+
+TokenCursor::TokenCursor(Lexer &lexer) {
+  // a lexer that already ran lex() has nothing left to stream
+  if (lexer.getTokens().empty()) {
+    lexer_ = &lexer;
+  } else {
+    tokens_ = &lexer.getTokens();
+    eof_.Line = tokens_->back().Line;
+  }
+}
+
+auto TokenCursor::peek(std::size_t n) -> const Token & {
+  assert(n < Lookahead && "peeking further than the lookahead window");
+  if (tokens_ != nullptr) {
+    // everything is lexed already, no need to buffer anything
+    return pos_ + n < tokens_->size() ? (*tokens_)[pos_ + n] : eof_;
+  }
+  while (count_ <= n) {
+    window_[(head_ + count_) % Lookahead] = pull();
+    ++count_;
+  }
+  return window_[(head_ + n) % Lookahead];
+}
+
+auto TokenCursor::peekType(std::size_t n) -> TokenType {
+  if (compact_ == nullptr) {
+    return peek(n).Type;
+  }
+  if (n < count_) {
+    // the window can hold END_OF_FILEs that never came out of compact_
+    return window_[(head_ + n) % Lookahead].Type;
+  }
+  auto index = pos_ + (n - count_);
+  if (index < compact_->size()) {
+    return compact_->getType(index);
+  }
+  return TokenType::END_OF_FILE;
+}
+
+auto TokenCursor::consume() -> const Token & {
+  if (tokens_ != nullptr) {
+    return pos_ < tokens_->size() ? (*tokens_)[pos_++] : eof_;
+  }
+  peek();
+  consumed_ = std::move(window_[head_]);
+  head_ = (head_ + 1) % Lookahead;
+  --count_;
+  return consumed_;
+}
+
+auto TokenCursor::pull() -> Token {
+  // once the end is reached keep handing out END_OF_FILE
+  if (seen_eof_) {
+    return Token{.Line = eof_line_, .Type = TokenType::END_OF_FILE};
+  }
+  auto token = Token{.Type = TokenType::END_OF_FILE};
+  if (lexer_ != nullptr) {
+    token = lexer_->next();
+  } else if (compact_ != nullptr && pos_ < compact_->size()) {
+    token = compact_->getToken(pos_++);
+  }
+  seen_eof_ = token.Type == TokenType::END_OF_FILE;
+  eof_line_ = token.Line;
+  return token;
+}
@@ -0,0 +1,51 @@
+#ifndef TOKEN_CURSOR_H
+#define TOKEN_CURSOR_H
+
+#include "CompactTokens.h"
+#include "Lexer.h"
+#include "Token.h"
+#include <array>
+#include <vector>
+
+// The parser's view of the token stream: a small window of lookahead over
+// either an already lexed vector (tests, debugging), a CompactTokens stream or
+// a Lexer that is pulled on demand. When streaming, only the window is ever
+// held in memory, however big the file is.
+class TokenCursor {
+public:
+  static constexpr auto Lookahead = std::size_t{4};
+
+  explicit TokenCursor(const std::vector<Token> &tokens);
+  explicit TokenCursor(const CompactTokens &tokens);
+  explicit TokenCursor(Lexer &lexer);
+
+  // n must be less than Lookahead. Past the end this is END_OF_FILE.
+  auto peek(std::size_t n = 0) -> const Token &;
+  // same as peek(n).Type, but only reads the type array of compact streams
+  auto peekType(std::size_t n = 0) -> TokenType;
+  // the token stays valid until the next consume()
+  auto consume() -> const Token &;
+
+private:
+  // next token out of compact_ or lexer_ (tokens_ is read in place)
+  auto pull() -> Token;
+
+private:
+  const std::vector<Token> *tokens_ = nullptr;
+  const CompactTokens *compact_ = nullptr;
+  Lexer *lexer_ = nullptr;
+  // next token to pull out of tokens_ or compact_
+  std::size_t pos_ = 0;
+  bool seen_eof_ = false;
+  std::size_t eof_line_ = 0;
+  // ring buffer, window_[head_] is the current token
+  std::array<Token, Lookahead> window_;
+  std::size_t head_ = 0;
+  std::size_t count_ = 0;
+  // what consume() handed out last when reading through the window
+  Token consumed_;
+  // handed out past the end of tokens_
+  Token eof_{.Type = TokenType::END_OF_FILE};
+};
+
+#endif // !TOKEN_CURSOR_H
@@ -0,0 +1,324 @@
+#include "TypeChecker.h"
+#include "Error.h"
+#include "Token.h"
+#include <format>
+
+namespace {
+auto typeName(StaticType type) -> std::string_view {
+  switch (type) {
+  case StaticType::Float:
+    return "Float";
+  case StaticType::Bool:
+    return "Bool";
+  case StaticType::String:
+    return "String";
+  case StaticType::Nil:
+    return "nil";
+  default:
+    return "unknown";
+  }
+}
+
+// what the parser recorded after the ':'
+auto declaredType(std::string_view type) -> StaticType {
+  if (type == "Float") {
+    return StaticType::Float;
+  }
+  if (type == "Bool") {
+    return StaticType::Bool;
+  }
+  if (type == "String") {
+    return StaticType::String;
+  }
+  return StaticType::Unknown;
+}
+
+auto operatorSymbol(TokenType op) -> std::string_view {
+  switch (op) {
+  case TokenType::PLUS:
+    return "+";
+  case TokenType::MINUS:
+    return "-";
+  case TokenType::MUL:
+    return "*";
+  case TokenType::DIV:
+    return "/";
+  case TokenType::LESS_THAN:
+    return "<";
+  case TokenType::LESS_THAN_OR_EQUAL:
+    return "<=";
+  case TokenType::GREATER_THAN:
+    return ">";
+  case TokenType::GREATER_THAN_OR_EQUAL:
+    return ">=";
+  default:
+    return "?";
+  }
+}
+
+// every type each global is declared with, a global declared as two
+// different things can't be trusted anywhere
+struct GlobalTypes {
+  std::vector<StaticType> Types;
+  std::vector<bool> Seen;
+
+  auto visit(Statement *statement) -> void {
+    visitStatement(*this, statement);
+  }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void {}
+  auto visit(VariableDeclaration *statement) -> void {
+    if (statement->Target.Kind != SlotKind::Global) {
+      return;
+    }
+    auto index = statement->Target.Index;
+    if (index >= Types.size()) {
+      Types.resize(index + 1, StaticType::Unknown);
+      Seen.resize(index + 1, false);
+    }
+    auto type = declaredType(statement->Type);
+    Types[index] = !Seen[index] || Types[index] == type ? type
+                                                         : StaticType::Unknown;
+    Seen[index] = true;
+  }
+  auto visit(Assignment *statement) -> void {}
+  auto visit(BlockScope *statement) -> void {
+    for (auto *child : statement->Statements) {
+      visit(child);
+    }
+  }
+  auto visit(IfStatement *statement) -> void {
+    visit(statement->IfBody);
+    if (statement->ElseBody.has_value()) {
+      visit(*statement->ElseBody);
+    }
+  }
+  auto visit(WhileStatement *statement) -> void { visit(statement->Body); }
+};
+} // namespace
+
+TypeChecker::TypeChecker(ProgramNode &program) : program_{program} {}
+
+auto TypeChecker::run() -> void {
+  auto globals = GlobalTypes{};
+  for (auto *statement : program_.Statements) {
+    globals.visit(statement);
+  }
+  globals_ = std::move(globals.Types);
+  unproven_globals_.assign(globals_.size(), false);
+  walk();
+  // a proof lost in one walk can take others with it in the next, this stops
+  // once a walk loses none (at worst one walk per variable)
+  proving_ = true;
+  do {
+    changed_ = false;
+    walk();
+  } while (changed_);
+}
+
+auto TypeChecker::walk() -> void {
+  for (auto *statement : program_.Statements) {
+    visit(statement);
+  }
+}
+
+auto TypeChecker::visit(VariableDeclaration *statement) -> void {
+  auto value = visit(statement->AssignedValue);
+  auto declared = declaredType(statement->Type);
+  checkStore(statement->Name, declared, value, statement->Line);
+  if (statement->Target.Kind == SlotKind::Local) {
+    auto index = statement->Target.Index;
+    if (index >= locals_.size()) {
+      locals_.resize(index + 1, nullptr);
+    }
+    locals_[index] = statement;
+  }
+  if (value != declared) {
+    unprove(statement->Target);
+  }
+}
+
+auto TypeChecker::visit(Assignment *statement) -> void {
+  auto value = visit(statement->AssignmentValue);
+  auto declared = typeOf(statement->Target);
+  checkStore(statement->Name, declared, value, statement->Line);
+  if (value != declared) {
+    unprove(statement->Target);
+  }
+}
+
+auto TypeChecker::visit(BlockScope *statement) -> void {
+  for (auto *child : statement->Statements) {
+    visit(child);
+  }
+}
+
+auto TypeChecker::visit(IfStatement *statement) -> void {
+  // anything can be a condition, it's tested for truthiness
+  visit(statement->Condition);
+  visit(statement->IfBody);
+  if (statement->ElseBody.has_value()) {
+    visit(*statement->ElseBody);
+  }
+}
+
+auto TypeChecker::visit(WhileStatement *statement) -> void {
+  visit(statement->Condition);
+  visit(statement->Body);
+}
+
+auto TypeChecker::visit(BinaryOperation *node) -> StaticType {
+  auto left = visit(node->Left);
+  auto right = visit(node->Right);
+  auto known = left != StaticType::Unknown && right != StaticType::Unknown;
+  switch (node->Operator) {
+  case TokenType::EQUALITY:
+  case TokenType::INEQUALITY:
+    // values of different types are just not equal
+    return StaticType::Bool;
+  case TokenType::PLUS:
+    if (known && left == right &&
+        (left == StaticType::Float || left == StaticType::String)) {
+      return left;
+    }
+    if (known) {
+      error(std::format("Cannot add {} and {}, + needs two Floats or two "
+                        "Strings!",
+                        typeName(left), typeName(right)),
+            node->Line);
+    }
+    return StaticType::Unknown;
+  case TokenType::LESS_THAN:
+  case TokenType::LESS_THAN_OR_EQUAL:
+  case TokenType::GREATER_THAN:
+  case TokenType::GREATER_THAN_OR_EQUAL:
+    // how two Strings order is up to the VM (the ConstantFolder doesn't fold
+    // it either), they only have to be the same type
+    if (known && left == right &&
+        (left == StaticType::Float || left == StaticType::String)) {
+      return StaticType::Bool;
+    }
+    if (known) {
+      error(std::format("Cannot apply {} to {} and {}, it needs two Floats or "
+                        "two Strings!",
+                        operatorSymbol(node->Operator), typeName(left),
+                        typeName(right)),
+            node->Line);
+    }
+    return StaticType::Unknown;
+  case TokenType::MINUS:
+  case TokenType::MUL:
+  case TokenType::DIV: {
+    // one known wrong side is enough to fail
+    auto not_float = [](StaticType type) {
+      return type != StaticType::Unknown && type != StaticType::Float;
+    };
+    if (not_float(left) || not_float(right)) {
+      error(std::format("Cannot apply {} to {} and {}, it needs two Floats!",
+                        operatorSymbol(node->Operator), typeName(left),
+                        typeName(right)),
+            node->Line);
+      return StaticType::Unknown;
+    }
+    return known ? StaticType::Float : StaticType::Unknown;
+  }
+  default:
+    return StaticType::Unknown;
+  }
+}
+
+auto TypeChecker::visit(LogicalOperation *node) -> StaticType {
+  // both sides are only tested for truthiness
+  visit(node->Left);
+  visit(node->Right);
+  return StaticType::Bool;
+}
+
+auto TypeChecker::visit(UnaryOperation *node) -> StaticType {
+  auto right = visit(node->Right);
+  if (node->Operator == TokenType::NOT) {
+    return StaticType::Bool;
+  }
+  if (right == StaticType::Float || right == StaticType::Unknown) {
+    return right;
+  }
+  error(std::format("Cannot negate a {}!", typeName(right)), node->Line);
+  return StaticType::Unknown;
+}
+
+auto TypeChecker::visit(Literal *node) -> StaticType {
+  switch (LiteralVariantType{node->Value.index()}) {
+  case LiteralVariantType::NIL:
+    return StaticType::Nil;
+  case LiteralVariantType::STRING:
+    return StaticType::String;
+  case LiteralVariantType::DOUBLE:
+    return StaticType::Float;
+  case LiteralVariantType::BOOL:
+    return StaticType::Bool;
+  }
+  return StaticType::Unknown;
+}
+
+auto TypeChecker::visit(VariableEval *node) -> StaticType {
+  return provenTypeOf(node->Target);
+}
+
+auto TypeChecker::typeOf(Slot slot) const -> StaticType {
+  switch (slot.Kind) {
+  case SlotKind::Local:
+    return slot.Index < locals_.size() && locals_[slot.Index] != nullptr
+               ? declaredType(locals_[slot.Index]->Type)
+               : StaticType::Unknown;
+  case SlotKind::Global:
+    return slot.Index < globals_.size() ? globals_[slot.Index]
+                                        : StaticType::Unknown;
+  default:
+    return StaticType::Unknown;
+  }
+}
+
+auto TypeChecker::provenTypeOf(Slot slot) const -> StaticType {
+  if (!proving_) {
+    return typeOf(slot);
+  }
+  auto unproven =
+      slot.Kind == SlotKind::Local
+          ? slot.Index < locals_.size() &&
+                unproven_locals_.contains(locals_[slot.Index])
+          : slot.Kind == SlotKind::Global && slot.Index < globals_.size() &&
+                unproven_globals_[slot.Index];
+  return unproven ? StaticType::Unknown : typeOf(slot);
+}
+
+auto TypeChecker::unprove(Slot slot) -> void {
+  if (slot.Kind == SlotKind::Local && slot.Index < locals_.size()) {
+    changed_ |= unproven_locals_.insert(locals_[slot.Index]).second;
+  } else if (slot.Kind == SlotKind::Global && slot.Index < globals_.size() &&
+             !unproven_globals_[slot.Index]) {
+    unproven_globals_[slot.Index] = true;
+    changed_ = true;
+  }
+}
+
+auto TypeChecker::checkStore(std::string_view name, StaticType declared,
+                             StaticType actual, std::size_t line) -> void {
+  if (declared == StaticType::Unknown || actual == StaticType::Unknown ||
+      declared == actual) {
+    return;
+  }
+  error(std::format("Cannot store a {} in {}, it is declared {}!",
+                    typeName(actual), name, typeName(declared)),
+        line);
+}
+
+auto TypeChecker::error(std::string_view message, std::size_t line) -> void {
+  if (proving_) {
+    // already reported, or only showing up because a proof was lost
+    return;
+  }
+  ++error_count_;
+  auto filename =
+      program_.Source != nullptr ? program_.Source->getName() : "";
+  reportError(message, filename, line);
+}
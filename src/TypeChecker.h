@@ -0,0 +1,75 @@
+#ifndef TYPE_CHECKER_H
+#define TYPE_CHECKER_H
+
+#include "AST.h"
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+// Runs after the Resolver. Reports the operations and assignments that are
+// bound to go wrong at runtime, going by the declared types of the variables.
+// Then works out the StaticType of every expression. A variable only counts
+// as its declared type there if every store into it is proven to be that
+// type, so `x: Float -> g;` with an unknown g leaves every read of x Unknown.
+// Anything it can't prove stays Unknown and is left for the VM to check.
+// Nothing reads the StaticTypes yet, CodeGen emits the same generic opcodes
+// whatever they are (the VM has no specialized ones), so for now the pass
+// only reports errors.
+class TypeChecker {
+public:
+  explicit TypeChecker(ProgramNode &program);
+  auto run() -> void;
+  auto getErrorCount() const -> std::size_t { return error_count_; }
+
+  auto visit(Statement *statement) -> void { visitStatement(*this, statement); }
+  auto visit(InvalidStatement *statement) -> void {}
+  auto visit(PrintStatement *statement) -> void { visit(statement->Expr); }
+  auto visit(VariableDeclaration *statement) -> void;
+  auto visit(Assignment *statement) -> void;
+  auto visit(BlockScope *statement) -> void;
+  auto visit(IfStatement *statement) -> void;
+  auto visit(WhileStatement *statement) -> void;
+
+  // expressions return their type and store it in the node
+  auto visit(Expression *node) -> StaticType {
+    return node->Type = visitExpression(*this, node);
+  }
+  auto visit(BinaryOperation *node) -> StaticType;
+  auto visit(LogicalOperation *node) -> StaticType;
+  auto visit(UnaryOperation *node) -> StaticType;
+  auto visit(Grouping *node) -> StaticType { return visit(node->Expr); }
+  auto visit(Literal *node) -> StaticType;
+  auto visit(VariableEval *node) -> StaticType;
+  auto visit(InvalidExpression *node) -> StaticType {
+    return StaticType::Unknown;
+  }
+
+private:
+  auto walk() -> void;
+  // the declared type of whatever the slot holds right now
+  auto typeOf(Slot slot) const -> StaticType;
+  // typeOf, but Unknown while proving if the variable lost its proof
+  auto provenTypeOf(Slot slot) const -> StaticType;
+  // something other than the declared type went into the slot's variable
+  auto unprove(Slot slot) -> void;
+  // reports storing a value of type actual in a variable declared declared
+  auto checkStore(std::string_view name, StaticType declared,
+                  StaticType actual, std::size_t line) -> void;
+  auto error(std::string_view message, std::size_t line) -> void;
+
+private:
+  ProgramNode &program_;
+  // by stack offset, the last local declared in each slot
+  std::vector<const VariableDeclaration *> locals_;
+  // Unknown for globals that are declared with more than one type
+  std::vector<StaticType> globals_;
+  // set after the walk that reports errors, the walks that follow only take
+  // proofs away until nothing changes
+  bool proving_ = false;
+  bool changed_ = false;
+  std::unordered_set<const VariableDeclaration *> unproven_locals_;
+  std::vector<bool> unproven_globals_;
+  std::size_t error_count_ = 0;
+};
+
+#endif // !TYPE_CHECKER_H
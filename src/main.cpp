@@ -1,38 +1,114 @@
 #include "AST.h"
 #include "CodeGenVisitor.h"
+#include "CompactTokens.h"
+#include "ConstantFolder.h"
+#include "Disassembler.h"
 #include "Lexer.h"
+#include "LineTable.h"
+#include "LoopOptimizer.h"
 #include "Parser.h"
+#include "Peephole.h"
 #include "Program.h"
+#include "Resolver.h"
+#include "Source.h"
+#include "TypeChecker.h"
 #include "VM.h"
 #include <fstream>
 #include <ios>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 auto main(int argc, char *argv[]) -> int {
-  auto program = std::ifstream("main.vrtx", std::ios_base::in);
-  auto program_str = std::string{};
-  auto s = std::string{};
-  while (std::getline(program, s)) {
-    program_str += s + '\n';
+  // usage: vlc [-O0] [--token-stats] [--fold-stats] [--constant-stats]
+  // [--line-stats] [file], "-" reads the program from stdin
+  auto path = std::string{"main.vrtx"};
+  auto token_stats = false;
+  auto fold_stats = false;
+  auto constant_stats = false;
+  auto line_stats = false;
+  // 0 leaves the bytecode exactly as CodeGen wrote it
+  auto opt_level = 1;
+  for (auto i = 1; i < argc; ++i) {
+    auto arg = std::string_view{argv[i]};
+    if (arg == "-O0" || arg == "-O1") {
+      opt_level = arg[2] - '0';
+    } else if (arg == "--token-stats") {
+      token_stats = true;
+    } else if (arg == "--fold-stats") {
+      fold_stats = true;
+    } else if (arg == "--constant-stats") {
+      constant_stats = true;
+    } else if (arg == "--line-stats") {
+      line_stats = true;
+    } else {
+      path = arg;
+    }
+  }
+  auto source = SourceFile::fromPath(path);
+  if (source == nullptr) {
+    return 1;
   }
   auto file = std::ofstream{"lexer_output.txt", std::ios_base::out};
-  auto lexer = Lexer{program_str, "main.vrtx", &file};
-  lexer.lex();
-  auto parser = Parser{"main.vrtx", lexer.getTokens()};
+  auto lexer = Lexer{source, &file};
+  auto compact_tokens = std::optional<CompactTokens>{};
+  if (source->getText().size() >= Lexer::ParallelThreshold) {
+    // big enough to be worth lexing up front on all cores. That trades the
+    // streaming parser's constant memory for a token vector the size of the
+    // whole file, tokens are 48 bytes each so that's a few times the source.
+    lexer.lex();
+  }
+  if (token_stats) {
+    compact_tokens = CompactTokens::fromLexer(lexer);
+    printTokenMemoryReport(std::cout, *compact_tokens);
+  }
+  // otherwise the parser pulls tokens straight out of the lexer
+  auto parser = compact_tokens ? Parser{*compact_tokens} : Parser{lexer};
   auto &e{parser.parse()};
+  auto folder = ConstantFolder{e};
+  folder.run();
+  if (fold_stats) {
+    std::cout << "constant folding removed " << folder.getRemovedNodes()
+              << " nodes\n";
+  }
+  if (opt_level > 0) {
+    LoopOptimizer{e, folder.getFloatVariables()}.run();
+  }
+  auto resolver = Resolver{e};
+  resolver.run();
+  auto checker = TypeChecker{e};
+  checker.run();
+  if (resolver.getErrorCount() > 0 || checker.getErrorCount() > 0) {
+    // CodeGen can't do anything sensible with unresolved variables
+    return 1;
+  }
   auto p = Program{};
   auto g = CodeGen{p};
   for (auto &stmt : e.Statements) {
-    stmt->acceptVisitor(&g);
+    g.visit(stmt);
+  }
+  if (constant_stats) {
+    std::cout << "constant pool: " << g.getConstants().getSize() << " of "
+              << g.getConstants().getRequestCount() << " constants kept\n";
   }
 
-  wrapUp(p);
-  p.dissassemble("main.vbyte");
+  g.wrapUp();
+  if (opt_level > 0) {
+    Peephole{p, g.getConstants(), g.getLines()}.run();
+  }
+  const auto &lines = g.getLines();
+  if (line_stats) {
+    std::cout << "line table: " << lines.getRunCount() << " runs in "
+              << lines.getBytesUsed() << " bytes, "
+              << lines.size() * sizeof(std::size_t)
+              << " bytes with a line per byte\n";
+  }
+  auto listing = std::ofstream{"main.vbyte"};
+  disassemble(p, lines, listing);
   auto vm = VM{p};
   std::cout << "Vortex interpreter:\n";
   vm.run();
-  program.close();
   /*auto p = Program{};
   auto c = CodeGenVisitor{p};
   e[0]->acceptVisitor(&c);
@@ -0,0 +1,199 @@
+#include "Assembler.h"
+#include "CodeGenVisitor.h"
+#include "ConstantFolder.h"
+#include "ConstantPool.h"
+#include "Disassembler.h"
+#include "Lexer.h"
+#include "LineTable.h"
+#include "LoopOptimizer.h"
+#include "Parser.h"
+#include "Peephole.h"
+#include "Program.h"
+#include "Resolver.h"
+#include "VM.h"
+#include "gtest/gtest.h"
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+TEST(CodeGen, ConstantPoolSharesEqualValues) {
+  auto program = Program{};
+  auto pool = ConstantPool{program};
+  auto strings = StringInterner{};
+  EXPECT_EQ(pool.addDouble(1), pool.addDouble(1.0));
+  EXPECT_NE(pool.addDouble(0.0), pool.addDouble(-0.0)); // different bits
+  EXPECT_EQ(pool.addString(strings.intern("hi")),
+            pool.addString(strings.intern("hi")));
+  EXPECT_NE(pool.addString(strings.intern("hi")), pool.addDouble(1));
+  EXPECT_EQ(pool.getRequestCount(), 8);
+  EXPECT_EQ(pool.getSize(), 4);
+  EXPECT_EQ(program.Constants.size(), 4);
+}
+
+TEST(CodeGen, RepeatedLiteralsShareConstants) {
+  auto lexer = Lexer{"a: Float -> 2;\n"
+                     "print a * 2; print a + 2; print \"x\"; print \"x\";\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  ConstantFolder{program}.run();
+  Resolver{program}.run();
+  auto bytecode = Program{};
+  auto codegen = CodeGen{bytecode};
+  for (auto *statement : program.Statements) {
+    codegen.visit(statement);
+  }
+  // 2, "x" and the global index 0
+  EXPECT_EQ(codegen.getConstants().getSize(), 3);
+  EXPECT_EQ(bytecode.Constants.size(), 3);
+}
+
+TEST(CodeGen, AssemblerPatchesJumps) {
+  auto program = Program{};
+  auto pool = ConstantPool{program};
+  auto assembler = Assembler{program, pool};
+  auto target = [&](std::size_t jump) {
+    auto index = (program.Bytecode[jump + 1] << 16) |
+                 (program.Bytecode[jump + 2] << 8) | program.Bytecode[jump + 3];
+    return program.Constants[index].Value.AsDouble;
+  };
+  auto top = assembler.newLabel();
+  auto end = assembler.newLabel();
+  assembler.bind(top);
+  assembler.emit(PUSH_TRUE, 1);
+  assembler.emitJump(JMP_TO_IF_FALSE, end, 1); // at 1
+  assembler.emitJump(JMP_TO_IF_FALSE, end, 1); // at 6
+  assembler.emitJump(JMP_TO, top, 2);          // at 11
+  EXPECT_EQ(assembler.getUnresolvedCount(), 2);
+  assembler.bind(end);
+  EXPECT_EQ(assembler.getUnresolvedCount(), 0);
+  ASSERT_EQ(program.Bytecode.size(), 16);
+  EXPECT_EQ(target(1), 16);
+  EXPECT_EQ(target(6), 16);
+  EXPECT_EQ(target(11), 0);
+  EXPECT_EQ(assembler.getLines().size(), 16);
+  EXPECT_EQ(assembler.getLines().lineAt(10), 1);
+  EXPECT_EQ(assembler.getLines().lineAt(15), 2);
+}
+
+TEST(CodeGen, LineTableTracksEmittedCode) {
+  auto lexer = Lexer{"a: Float -> 1;\n"
+                     "\n"
+                     "while a < 3 {\n"
+                     "  print a;\n"
+                     "  a -> a + 1; }\n"
+                     "print \"done\";\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  Resolver{program}.run();
+  auto bytecode = Program{};
+  auto codegen = CodeGen{bytecode};
+  for (auto *statement : program.Statements) {
+    codegen.visit(statement);
+  }
+  codegen.wrapUp();
+  auto &lines = codegen.getLines();
+  ASSERT_EQ(lines.size(), bytecode.Bytecode.size());
+  // the lines of the two prints
+  auto expected = std::vector<std::size_t>{4, 6};
+  auto printed = std::vector<std::size_t>{};
+  for (std::size_t pc = 0; pc < bytecode.Bytecode.size(); ++pc) {
+    if (bytecode.Bytecode[pc] == PUSHC) {
+      pc += 3;
+    } else if (bytecode.Bytecode[pc] == PRINT) {
+      printed.push_back(lines.lineAt(pc));
+    }
+  }
+  EXPECT_EQ(printed, expected);
+  EXPECT_EQ(lines.lineAt(0), 1);
+  EXPECT_EQ(lines.lineAt(bytecode.Bytecode.size() - 1), 0);
+  // operand bytes never start a run of their own
+  EXPECT_LT(lines.getRunCount(), bytecode.Bytecode.size() / 4);
+  EXPECT_TRUE(bytecode.Lines.empty());
+
+  auto listing = std::ostringstream{};
+  disassemble(bytecode, lines, listing);
+  auto text = listing.str();
+  EXPECT_EQ(text.substr(0, text.find('\n')), "0000    1 PUSHC 0 (1)");
+  EXPECT_NE(text.find("    | SAVE_GLOB"), std::string::npos);
+  EXPECT_NE(text.find("    4 "), std::string::npos);
+}
+
+namespace {
+struct Run {
+  std::size_t Size;
+  std::string Output;
+};
+
+// compiles and runs text, with or without the optional passes
+auto compileAndRun(const std::string &text, bool optimize) -> Run {
+  auto lexer = Lexer{text, "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto folder = ConstantFolder{program};
+  folder.run();
+  if (optimize) {
+    LoopOptimizer{program, folder.getFloatVariables()}.run();
+  }
+  Resolver{program}.run();
+  auto bytecode = Program{};
+  auto codegen = CodeGen{bytecode};
+  for (auto *statement : program.Statements) {
+    codegen.visit(statement);
+  }
+  codegen.wrapUp();
+  if (optimize) {
+    Peephole{bytecode, codegen.getConstants(), codegen.getLines()}.run();
+  }
+  EXPECT_EQ(codegen.getLines().size(), bytecode.Bytecode.size());
+  testing::internal::CaptureStdout();
+  auto vm = VM{bytecode};
+  vm.run();
+  return {bytecode.Bytecode.size(), testing::internal::GetCapturedStdout()};
+}
+} // namespace
+
+TEST(CodeGen, OptimizationsKeepBehaviour) {
+  const auto programs = std::array{
+      "i: Float -> 0;\n"
+      "while i < 3 { if i = 1 { print \"one\"; } else { print i; }\n"
+      "  i -> i + 1; }\n"s,
+      // nested ifs jump to a jump
+      "a: Float -> 2;\n"
+      "if a > 1 { if a > 3 { print 3; } else { print 1; } } else { print 0; }\n"
+      "print !!(a = 2);\n"s,
+      // an empty else jumps to the next instruction
+      "b: Float -> 1; if b = 1 { print b; } else {} print b + 1;\n"s,
+      "c: Float -> 0; while c < 2 { { d: Float -> c; print d; } c -> c + 1; }"
+      "\nif !!c { print \"truthy\"; }\n"s,
+      // invariant pieces of the loops move out
+      "n: Float -> 3; j: Float -> 0;\n"
+      "while j < n * 2 { k: Float -> 0;\n"
+      "  while !(k >= n - 1) { print k * (n + 1) + j; k -> k + 1; }\n"
+      "  j -> j + 1; }\n"
+      "while j < 0 { print n / 0; }\n"s,
+      // the right side never runs when the left decides, "s" - 1 would fail
+      "t: Float -> 1; f: Bool -> false; s: String -> \"s\";\n"
+      "print t > 0 || s - 1; print f && s - 1; print t && !f;\n"
+      "if f || t > 0 && !(f || t < 0) { print \"guarded\"; }\n"
+      "while t < 4 && !f || f { t -> t + 1; } print t;\n"s,
+      // a bare declaration as the body belongs to the scope around the loop
+      "n: Float -> 2; x: Float -> 0;\n"
+      "while x < n * 2 x: Float -> x + 1; print x;\n"s,
+      // m is only declared if c, so m * 2 can't run before the loop
+      "c: Bool -> false; if c m: Float -> 1;\n"
+      "while c { print m * 2; } print \"done\";\n"s,
+  };
+  auto shrunk = false;
+  for (const auto &text : programs) {
+    auto plain = compileAndRun(text, false);
+    auto optimized = compileAndRun(text, true);
+    EXPECT_EQ(plain.Output, optimized.Output) << text;
+    shrunk |= optimized.Size < plain.Size;
+  }
+  EXPECT_TRUE(shrunk);
+}
@@ -1,5 +1,8 @@
+#include "CompactTokens.h"
 #include "Lexer.h"
+#include "Scan.h"
 #include "gtest/gtest.h"
+#include <random>
 #include <string>
 
 using namespace std::string_literals;
@@ -17,3 +20,262 @@ TEST(Lexer, Identifers) {
   EXPECT_EQ(tokens[4].Lexeme, "a_b_c");
   EXPECT_EQ(tokens[5].Lexeme, "_abcdefghijklmnopqrstuvwxyz1234567890_");
 }
+
+TEST(Lexer, LexemesViewSharedSource) {
+  auto source = SourceFile::fromString("print abc;", "tests.vrtx");
+  auto tokens = std::vector<Token>{};
+  {
+    auto lexer = Lexer{source};
+    lexer.lex();
+    tokens = lexer.getTokens();
+  }
+  // the lexer is gone, but the lexemes still point into the shared buffer
+  ASSERT_EQ(tokens.size(), 4);
+  EXPECT_EQ(tokens[1].Lexeme, "abc");
+  EXPECT_EQ(tokens[1].Lexeme.data(), source->getText().data() + 6);
+}
+
+TEST(Lexer, Keywords) {
+  auto src = "Bool Float String if for while create return class super extern "
+             "true false Array nil print fn else"s;
+  auto lexer = Lexer{src, "tests.vrtx"};
+  lexer.lex();
+  auto &tokens = lexer.getTokens();
+  auto expected = std::vector<TokenType>{
+      TokenType::BOOL,   TokenType::FLOAT, TokenType::STRING, TokenType::IF,
+      TokenType::FOR,    TokenType::WHILE, TokenType::CREATE, TokenType::RETURN,
+      TokenType::CLASS,  TokenType::SUPER, TokenType::EXTERN, TokenType::TRUE,
+      TokenType::FALSE,  TokenType::ARRAY, TokenType::NIL,    TokenType::PRINT,
+      TokenType::FN,     TokenType::ELSE,  TokenType::END_OF_FILE};
+  ASSERT_EQ(tokens.size(), expected.size());
+  for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+    EXPECT_EQ(tokens[i].Type, expected[i]) << tokens[i].Lexeme;
+  }
+}
+
+TEST(Lexer, KeywordLookalikesAreIdentifiers) {
+  auto src = "bool iff f whiles Print nill fnx elsewhere i"s;
+  auto lexer = Lexer{src, "tests.vrtx"};
+  lexer.lex();
+  auto &tokens = lexer.getTokens();
+  ASSERT_EQ(tokens.size(), 10);
+  for (auto i = std::size_t{0}; i < tokens.size() - 1; ++i) {
+    EXPECT_EQ(tokens[i].Type, TokenType::IDENTIFIER) << tokens[i].Lexeme;
+  }
+}
+
+TEST(Lexer, StringAtEndOfFile) {
+  auto lexer = Lexer{"print \"a\nb\"", "tests.vrtx"};
+  lexer.lex();
+  auto &tokens = lexer.getTokens();
+  ASSERT_EQ(tokens.size(), 3);
+  EXPECT_EQ(tokens[1].Type, TokenType::STRING_LITERAL);
+  EXPECT_EQ(std::get<InternedString>(tokens[1].Value).view(), "a\nb");
+  EXPECT_EQ(tokens[1].Line, 2);
+}
+
+namespace {
+// random mix of everything the scan kernels handle, with runs long enough to
+// cross the 16 and 32 byte boundaries
+auto randomSource(unsigned seed) -> std::string {
+  auto rng = std::mt19937{seed};
+  auto pick = [&](std::size_t n) { return rng() % n; };
+  auto word = [&](std::size_t length) {
+    const auto *chars = "abcXYZ_019";
+    auto out = std::string{};
+    for (auto i = std::size_t{0}; i < length; ++i) {
+      out += chars[pick(10)];
+    }
+    return out;
+  };
+  auto src = std::string{};
+  for (auto i = 0; i < 400; ++i) {
+    switch (pick(6)) {
+    case 0:
+      src += std::string(pick(40), ' ') + std::string(pick(3), '\n') +
+             std::string(pick(5), '\t') + "\r\n";
+      break;
+    case 1:
+      src += "# comment " + word(pick(70)) + " \"not a string\n";
+      break;
+    case 2:
+      src += "\"" + word(pick(50)) + "\n" + word(pick(20)) + "\" ";
+      break;
+    case 3:
+      src += "x" + word(pick(64)) + " ";
+      break;
+    case 4:
+      src += "a -> b + 1.5 >= c; ";
+      break;
+    default:
+      src += "\x80\xff{}";
+      break;
+    }
+  }
+  return src;
+}
+
+auto lexWith(ScanMode mode, const SourcePtr &src) -> std::vector<Token> {
+  setScanMode(mode);
+  auto lexer = Lexer{src};
+  lexer.lex();
+  setScanMode(ScanMode::Auto);
+  return lexer.getTokens();
+}
+} // namespace
+
+TEST(Lexer, VectorScanMatchesScalar) {
+  for (auto mode : {ScanMode::SSE2, ScanMode::AVX2}) {
+    if (!setScanMode(mode)) {
+      continue; // the cpu can't run it
+    }
+    for (auto seed = 0u; seed < 8; ++seed) {
+      auto src = SourceFile::fromString(randomSource(seed), "tests.vrtx");
+      auto expected = lexWith(ScanMode::Scalar, src);
+      auto actual = lexWith(mode, src);
+      ASSERT_EQ(actual.size(), expected.size());
+      for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+        EXPECT_EQ(actual[i].Type, expected[i].Type);
+        EXPECT_EQ(actual[i].Lexeme, expected[i].Lexeme);
+        EXPECT_EQ(actual[i].Line, expected[i].Line);
+      }
+    }
+  }
+}
+
+TEST(Lexer, CompactTokensRoundTrip) {
+  auto src = "x: String -> \"hi\";\nprint x + 2.5; # done\n"s;
+  auto lexer = Lexer{src, "tests.vrtx"};
+  lexer.lex();
+  auto &expected = lexer.getTokens();
+  auto stream_lexer = Lexer{lexer.getSource()};
+  auto compact = CompactTokens::fromLexer(stream_lexer);
+  ASSERT_EQ(compact.size(), expected.size());
+  for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+    auto token = compact.getToken(i);
+    EXPECT_EQ(token.Type, expected[i].Type);
+    EXPECT_EQ(token.Lexeme, expected[i].Lexeme);
+    EXPECT_EQ(token.Line, expected[i].Line);
+    EXPECT_EQ(token.Value.index(), expected[i].Value.index());
+  }
+  EXPECT_EQ(std::get<InternedString>(compact.getValue(4)).view(), "hi");
+  EXPECT_EQ(std::get<double>(compact.getValue(9)), 2.5);
+  EXPECT_LT(compact.getMemoryUsage(), expected.size() * sizeof(Token));
+}
+
+TEST(Lexer, Numbers) {
+  auto src = "7 2.5 1e3 2.5E-2 6e+1 0x1F 0X1.8p1 3else 1e999"s;
+  auto lexer = Lexer{src, "tests.vrtx"};
+  lexer.lex();
+  auto &tokens = lexer.getTokens();
+  ASSERT_EQ(tokens.size(), 11);
+  auto expected = std::vector<double>{7, 2.5, 1000, 0.025, 60, 31, 3, 3};
+  for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+    ASSERT_EQ(tokens[i].Type, TokenType::FLOAT_LITERAL) << tokens[i].Lexeme;
+    EXPECT_DOUBLE_EQ(std::get<double>(tokens[i].Value), expected[i]);
+  }
+  EXPECT_EQ(tokens[8].Type, TokenType::ELSE);
+  // out of range is a vortex error, not an exception
+  EXPECT_EQ(tokens[9].Type, TokenType::INVALID);
+  EXPECT_EQ(tokens[9].Lexeme, "1e999");
+}
+
+TEST(Lexer, StringLiteralsAreInterned) {
+  auto lexer = Lexer{"\"abc\" \"xyz\" \"abc\""s, "tests.vrtx"};
+  lexer.lex();
+  auto &tokens = lexer.getTokens();
+  ASSERT_EQ(tokens.size(), 4);
+  auto first = std::get<InternedString>(tokens[0].Value);
+  auto second = std::get<InternedString>(tokens[1].Value);
+  auto third = std::get<InternedString>(tokens[2].Value);
+  EXPECT_EQ(first, third);
+  EXPECT_EQ(first.view().data(), third.view().data());
+  EXPECT_NE(first, second);
+  EXPECT_EQ(lexer.getInterner()->size(), 2);
+}
+
+TEST(Lexer, ParallelMatchesSequential) {
+  auto text = std::string{};
+  for (auto seed = 0u; seed < 4; ++seed) {
+    text += randomSource(seed) + "\n";
+  }
+  text += "print \"unterminated\n# at the very end";
+  auto src = SourceFile::fromString(text, "tests.vrtx");
+
+  testing::internal::CaptureStderr();
+  auto sequential = Lexer{src};
+  // below the threshold, so this is the plain sequential lexer
+  sequential.lex();
+  auto sequential_errors = testing::internal::GetCapturedStderr();
+
+  testing::internal::CaptureStderr();
+  auto parallel = Lexer{src};
+  parallel.lexParallel(16);
+  auto parallel_errors = testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(parallel_errors, sequential_errors);
+  auto &expected = sequential.getTokens();
+  auto &actual = parallel.getTokens();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].Type, expected[i].Type);
+    EXPECT_EQ(actual[i].Lexeme.data(), expected[i].Lexeme.data());
+    EXPECT_EQ(actual[i].Line, expected[i].Line);
+    EXPECT_EQ(actual[i].Value.index(), expected[i].Value.index());
+  }
+  EXPECT_EQ(parallel.getInterner()->size(), sequential.getInterner()->size());
+}
+
+TEST(Lexer, ParallelResyncsAcrossStrings) {
+  // one string with newlines covering most of the file, so the splits land
+  // inside it
+  auto text = std::string{"a: Float -> 1;\nprint \""};
+  for (auto i = 0; i < 1000; ++i) {
+    text += "line " + std::to_string(i) + "\n";
+  }
+  text += "\";\nprint a;\n";
+  auto src = SourceFile::fromString(text, "tests.vrtx");
+  auto sequential = Lexer{src};
+  sequential.lex();
+  auto parallel = Lexer{src};
+  parallel.lexParallel(8);
+  auto &expected = sequential.getTokens();
+  auto &actual = parallel.getTokens();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (auto i = std::size_t{0}; i < expected.size(); ++i) {
+    EXPECT_EQ(actual[i].Type, expected[i].Type);
+    EXPECT_EQ(actual[i].Lexeme.data(), expected[i].Lexeme.data());
+    EXPECT_EQ(actual[i].Line, expected[i].Line);
+  }
+}
+
+TEST(Lexer, ApplyEditMatchesFullRelex) {
+  auto rng = std::mt19937{7};
+  auto inserts = std::vector<std::string>{
+      "", "x", "\"", "#", "\n", " ", "1e", "+5", "->", "=", "0x", "\"a\nb\" "};
+  auto src = SourceFile::fromString(randomSource(3), "tests.vrtx");
+  testing::internal::CaptureStderr();
+  auto lexer = Lexer{src};
+  auto tokens = CompactTokens::fromLexer(lexer);
+  for (auto i = 0; i < 200; ++i) {
+    auto size = tokens.getSource()->getText().size();
+    auto offset = rng() % (size + 1);
+    auto removed = std::min<std::size_t>(rng() % 4, size - offset);
+    auto edit = TextEdit{.Offset = offset,
+                         .RemovedLength = removed,
+                         .Inserted = inserts[rng() % inserts.size()]};
+    tokens.applyEdit(edit);
+
+    auto full_lexer = Lexer{tokens.getSource()};
+    auto expected = CompactTokens::fromLexer(full_lexer);
+    ASSERT_EQ(tokens.size(), expected.size()) << "edit " << i;
+    for (auto j = std::size_t{0}; j < expected.size(); ++j) {
+      ASSERT_EQ(tokens.getType(j), expected.getType(j)) << "edit " << i;
+      ASSERT_EQ(tokens.getLexeme(j).data(), expected.getLexeme(j).data());
+      ASSERT_EQ(tokens.getLexeme(j), expected.getLexeme(j));
+      ASSERT_EQ(tokens.getLine(j), expected.getLine(j)) << "edit " << i;
+      ASSERT_EQ(tokens.getValue(j).index(), expected.getValue(j).index());
+    }
+  }
+  testing::internal::GetCapturedStderr();
+}
@@ -0,0 +1,143 @@
+#include "ConstantFolder.h"
+#include "Lexer.h"
+#include "LoopOptimizer.h"
+#include "Parser.h"
+#include "PrettyPrintExpressionVisitor.h"
+#include "Resolver.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace {
+// what each print statement of the program prints, as an expression
+auto printedExpressions(ProgramNode &program) -> std::vector<std::string> {
+  auto out = std::vector<std::string>{};
+  auto printer = PrettyPrintExpressionVisitor{};
+  for (auto *statement : program.Statements) {
+    if (statement->Kind != StatementKind::PrintStatement) {
+      continue;
+    }
+    testing::internal::CaptureStdout();
+    printer.visit(static_cast<PrintStatement *>(statement)->Expr);
+    out.push_back(testing::internal::GetCapturedStdout());
+  }
+  return out;
+}
+} // namespace
+
+TEST(ConstantFolder, FoldsLiterals) {
+  auto lexer = Lexer{"print 1 + 2 * 3;\n"
+                     "print (2 < 3) = true;\n"
+                     "print -(4);\n"
+                     "print \"a\" + \"b\";\n"
+                     "print 1 / 0;\n"
+                     "print \"a\" = \"a\";\n"
+                     "print false && x || true && false;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto folder = ConstantFolder{program};
+  folder.run();
+  auto expected = std::vector<std::string>{
+      "7", "true", "-4", "ab", "(1 DIV 0)", "(a EQUALITY a)", "false"};
+  EXPECT_EQ(printedExpressions(program), expected);
+  EXPECT_EQ(folder.getRemovedNodes(), 19);
+}
+
+TEST(ConstantFolder, IdentitiesNeedTrustedFloats) {
+  auto lexer = Lexer{"x: Float -> 2;\n"
+                     "s: String -> \"s\";\n"
+                     "z: Float -> 1;\n"
+                     "z -> s;\n"
+                     "print x * 1;\n"
+                     "print 1 * (x - 0);\n"
+                     "print s * 1;\n"
+                     "print z * 1;\n"
+                     "print x + 0;\n"
+                     "print x / 1 + -0;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto folder = ConstantFolder{program};
+  folder.run();
+  auto expected = std::vector<std::string>{
+      "x", "x", "(s MUL 1)", "(z MUL 1)", "(x PLUS 0)", "x"};
+  EXPECT_EQ(printedExpressions(program), expected);
+}
+
+TEST(ConstantFolder, DropsDeadBranches) {
+  auto lexer = Lexer{"if 1 < 2 print 1; else print 2;\n"
+                     "if false { print 3; print 4; }\n"
+                     "while 1 > 2 print 5;\n"
+                     "{ if !true print 6; else print 7; }\n"
+                     "while x print 8;\n"
+                     "if false y: Float -> 1;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto folder = ConstantFolder{program};
+  folder.run();
+  ASSERT_EQ(program.Statements.size(), 4);
+  EXPECT_EQ(program.Statements[0]->Kind, StatementKind::PrintStatement);
+  ASSERT_EQ(program.Statements[1]->Kind, StatementKind::BlockScope);
+  auto *block = static_cast<BlockScope *>(program.Statements[1]);
+  ASSERT_EQ(block->Statements.size(), 1);
+  EXPECT_EQ(block->Statements[0]->Kind, StatementKind::PrintStatement);
+  EXPECT_EQ(program.Statements[2]->Kind, StatementKind::WhileStatement);
+  EXPECT_EQ(program.Statements[3]->Kind, StatementKind::IfStatement);
+  EXPECT_EQ(printedExpressions(program), std::vector<std::string>{"1"});
+  EXPECT_EQ(folder.getRemovedNodes(), 24);
+
+  // declarations nested in unbraced bodies still belong to the outer scope
+  for (auto text : {"c: Bool -> true; if false if c x: Float -> 1; print x;"s,
+                    "c: Bool -> true; while false while c y: Float -> 1;\n"
+                    "print y;"s}) {
+    auto nested_lexer = Lexer{text, "tests.vrtx"};
+    auto nested_parser = Parser{nested_lexer};
+    auto &nested = nested_parser.parse();
+    ConstantFolder{nested}.run();
+    auto resolver = Resolver{nested};
+    resolver.run();
+    EXPECT_EQ(resolver.getErrorCount(), 0) << text;
+  }
+}
+
+TEST(LoopOptimizer, HoistsInvariantFloats) {
+  auto lexer = Lexer{"n: Float -> 4;\n"
+                     "s: String -> \"s\";\n"
+                     "i: Float -> 0;\n"
+                     "while i < n * 2 {\n"
+                     "  print -n + i;\n"
+                     "  print s + s;\n"
+                     "  { k: Float -> 3; print k * n; }\n"
+                     "  print n / 0;\n"
+                     "  if n > 1 { print n - 1; }\n"
+                     "  i -> i + 1;\n"
+                     "}\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto folder = ConstantFolder{program};
+  folder.run();
+  auto optimizer = LoopOptimizer{program, folder.getFloatVariables()};
+  optimizer.run();
+  // n * 2, -n, n > 1 and n - 1
+  EXPECT_EQ(optimizer.getHoistedCount(), 4);
+  ASSERT_EQ(program.Statements[3]->Kind, StatementKind::BlockScope);
+  auto *block = static_cast<BlockScope *>(program.Statements[3]);
+  ASSERT_EQ(block->Statements.size(), 5);
+  auto hoisted = std::vector<std::string>{};
+  auto printer = PrettyPrintExpressionVisitor{};
+  for (auto *statement : block->Statements.first(4)) {
+    ASSERT_EQ(statement->Kind, StatementKind::VariableDeclaration);
+    testing::internal::CaptureStdout();
+    printer.visit(static_cast<VariableDeclaration *>(statement)->AssignedValue);
+    hoisted.push_back(testing::internal::GetCapturedStdout());
+  }
+  auto expected = std::vector<std::string>{"(n MUL 2)", "(MINUS n)",
+                                           "(n GREATER_THAN 1)", "(n MINUS 1)"};
+  EXPECT_EQ(hoisted, expected);
+  EXPECT_EQ(block->Statements[4]->Kind, StatementKind::WhileStatement);
+}
@@ -1 +1,137 @@
+#include "CompactTokens.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "PrettyPrintExpressionVisitor.h"
+#include "TokenCursor.h"
 #include "gtest/gtest.h"
+#include <memory>
+#include <optional>
+#include <string>
+
+using namespace std::string_literals;
+
+TEST(Parser, TokenCursorLookahead) {
+  auto lexer = Lexer{"a -> b;"s, "tests.vrtx"};
+  auto cursor = TokenCursor{lexer};
+  EXPECT_EQ(cursor.peek(2).Lexeme, "b");
+  EXPECT_EQ(cursor.peek().Lexeme, "a");
+  EXPECT_EQ(cursor.consume().Type, TokenType::IDENTIFIER);
+  EXPECT_EQ(cursor.consume().Type, TokenType::ASSIGNMENT);
+  EXPECT_EQ(cursor.peek(3).Type, TokenType::END_OF_FILE);
+  EXPECT_EQ(cursor.consume().Lexeme, "b");
+  EXPECT_EQ(cursor.consume().Type, TokenType::SEMICOLON);
+  EXPECT_EQ(cursor.consume().Type, TokenType::END_OF_FILE);
+  EXPECT_EQ(cursor.consume().Type, TokenType::END_OF_FILE);
+
+  // peeking past the end puts END_OF_FILEs in the window that compact
+  // streams don't have
+  auto short_lexer = Lexer{"a"s, "tests.vrtx"};
+  auto tokens = CompactTokens::fromLexer(short_lexer);
+  auto compact = TokenCursor{tokens};
+  EXPECT_EQ(compact.peek(3).Type, TokenType::END_OF_FILE);
+  EXPECT_EQ(compact.peek(0).Type, TokenType::IDENTIFIER);
+  EXPECT_EQ(compact.peekType(0), TokenType::IDENTIFIER);
+  EXPECT_EQ(compact.peekType(1), TokenType::END_OF_FILE);
+  EXPECT_EQ(compact.peekType(3), TokenType::END_OF_FILE);
+  EXPECT_EQ(compact.consume().Type, TokenType::IDENTIFIER);
+  EXPECT_EQ(compact.peekType(0), TokenType::END_OF_FILE);
+}
+
+TEST(Parser, StreamingMatchesBatch) {
+  auto src = "x: Float -> 1.0 + 2.0 * 3.0;\n"
+             "print x;\n"
+             "{ y: Float -> x; y -> y - 1.0; }\n"
+             "while x < 3.0 x -> x + 1.0;\n"s;
+  auto batch_lexer = Lexer{src, "tests.vrtx"};
+  batch_lexer.lex();
+  auto batch_parser =
+      Parser{batch_lexer.getSource(), batch_lexer.getTokens()};
+  auto &batch = batch_parser.parse();
+
+  auto stream_lexer = Lexer{src, "tests.vrtx"};
+  auto stream_parser = Parser{stream_lexer};
+  auto &stream = stream_parser.parse();
+
+  ASSERT_EQ(stream.Statements.size(), 4);
+  ASSERT_EQ(batch.Statements.size(), stream.Statements.size());
+  for (auto i = std::size_t{0}; i < batch.Statements.size(); ++i) {
+    auto &expected = *batch.Statements[i];
+    auto &actual = *stream.Statements[i];
+    EXPECT_EQ(actual.Kind, expected.Kind);
+    EXPECT_EQ(actual.Line, expected.Line);
+  }
+}
+
+TEST(Parser, DeepTreesAreFreedAtOnce) {
+  // a left-leaning chain of 200k BinaryOperations, freeing it node by node
+  // used to recurse once per node
+  auto src = "print 1"s;
+  for (auto i = 0; i < 200000; ++i) {
+    src += " + 1";
+  }
+  src += ";";
+  auto lexer = Lexer{src, "tests.vrtx"};
+  auto parser = std::make_unique<Parser>(lexer);
+  auto &program = parser->parse();
+  ASSERT_EQ(program.Statements.size(), 1);
+  EXPECT_GT(program.Nodes.getBytesUsed(), 200000 * sizeof(BinaryOperation));
+  parser.reset();
+}
+
+TEST(Parser, NamesOutliveTokensWithoutSource) {
+  auto parser = std::optional<Parser>{};
+  auto *program = static_cast<ProgramNode *>(nullptr);
+  {
+    auto lexer =
+        Lexer{"counter: Float -> 1.0; s: String -> \"hello\";"s, "tests.vrtx"};
+    lexer.lex();
+    parser.emplace("tests.vrtx", lexer.getTokens());
+    program = &parser->parse();
+  }
+  ASSERT_EQ(program->Statements.size(), 2);
+  ASSERT_EQ(program->Statements[0]->Kind, StatementKind::VariableDeclaration);
+  auto *decl = static_cast<VariableDeclaration *>(program->Statements[0]);
+  EXPECT_EQ(decl->Name, "counter");
+  EXPECT_EQ(decl->Type, "Float");
+  ASSERT_EQ(program->Statements[1]->Kind, StatementKind::VariableDeclaration);
+  auto *greeting = static_cast<VariableDeclaration *>(program->Statements[1]);
+  ASSERT_EQ(greeting->AssignedValue->Kind, ExpressionKind::Literal);
+  auto *literal = static_cast<Literal *>(greeting->AssignedValue);
+  EXPECT_EQ(std::get<InternedString>(literal->Value).view(), "hello");
+  EXPECT_EQ(program->Strings->size(), 1);
+}
+
+TEST(Parser, PrettyPrintWalk) {
+  auto lexer = Lexer{"print -(a + 2) * b;"s, "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  ASSERT_EQ(program.Statements[0]->Kind, StatementKind::PrintStatement);
+  auto *print = static_cast<PrintStatement *>(program.Statements[0]);
+  auto printer = PrettyPrintExpressionVisitor{};
+  testing::internal::CaptureStdout();
+  printer.visit(print->Expr);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "((MINUS ((a PLUS 2))) MUL b)");
+}
+
+TEST(Parser, Precedence) {
+  auto lexer = Lexer{"print 1 - 2 - 3 * 4 < 5 != !a = -b;"s, "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  auto *print = static_cast<PrintStatement *>(program.Statements[0]);
+  auto printer = PrettyPrintExpressionVisitor{};
+  testing::internal::CaptureStdout();
+  printer.visit(print->Expr);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "(((((1 MINUS 2) MINUS (3 MUL 4)) LESS_THAN 5) INEQUALITY "
+            "(NOT a)) EQUALITY (MINUS b))");
+
+  auto logical = Lexer{"print a || b && c = 1 || !d;"s, "tests.vrtx"};
+  auto logical_parser = Parser{logical};
+  auto *logical_print = static_cast<PrintStatement *>(
+      logical_parser.parse().Statements[0]);
+  testing::internal::CaptureStdout();
+  printer.visit(logical_print->Expr);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "((a OR (b AND (c EQUALITY 1))) OR (NOT d))");
+}
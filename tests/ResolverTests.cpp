@@ -0,0 +1,54 @@
+#include "Lexer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace std::string_literals;
+
+TEST(Resolver, BindsLocalsAndGlobals) {
+  auto lexer = Lexer{"g: Float -> 1;\n"
+                     "{ a: Float -> g; { b: Float -> a; b -> g; }\n"
+                     "  c: Float -> 2; print c; }\n"
+                     "print nope;\n"
+                     "{ g: Float -> 1; }\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  testing::internal::CaptureStderr();
+  auto resolver = Resolver{program};
+  resolver.run();
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ(resolver.getErrorCount(), 2); // nope and the second g
+  EXPECT_EQ(resolver.getGlobalCount(), 1);
+
+  auto slot = [](Slot slot) { return std::pair{slot.Kind, slot.Index}; };
+  auto *g = static_cast<VariableDeclaration *>(program.Statements[0]);
+  EXPECT_EQ(slot(g->Target), std::pair(SlotKind::Global, 0u));
+
+  auto *outer = static_cast<BlockScope *>(program.Statements[1]);
+  ASSERT_EQ(outer->Statements.size(), 4);
+  EXPECT_EQ(outer->LocalCount, 2);
+  auto *a = static_cast<VariableDeclaration *>(outer->Statements[0]);
+  EXPECT_EQ(slot(a->Target), std::pair(SlotKind::Local, 0u));
+  auto *a_value = static_cast<VariableEval *>(a->AssignedValue);
+  EXPECT_EQ(slot(a_value->Target), std::pair(SlotKind::Global, 0u));
+
+  auto *inner = static_cast<BlockScope *>(outer->Statements[1]);
+  EXPECT_EQ(inner->LocalCount, 1);
+  auto *b = static_cast<VariableDeclaration *>(inner->Statements[0]);
+  EXPECT_EQ(slot(b->Target), std::pair(SlotKind::Local, 1u));
+  auto *assign = static_cast<Assignment *>(inner->Statements[1]);
+  EXPECT_EQ(slot(assign->Target), std::pair(SlotKind::Local, 1u));
+
+  // b is gone by now, so c reuses its slot
+  auto *c = static_cast<VariableDeclaration *>(outer->Statements[2]);
+  EXPECT_EQ(slot(c->Target), std::pair(SlotKind::Local, 1u));
+  auto *print = static_cast<PrintStatement *>(outer->Statements[3]);
+  auto *c_value = static_cast<VariableEval *>(print->Expr);
+  EXPECT_EQ(slot(c_value->Target), std::pair(SlotKind::Local, 1u));
+
+  auto *nope = static_cast<PrintStatement *>(program.Statements[2]);
+  EXPECT_EQ(static_cast<VariableEval *>(nope->Expr)->Target.Kind,
+            SlotKind::Unresolved);
+}
@@ -0,0 +1,87 @@
+#include "Lexer.h"
+#include "Parser.h"
+#include "Resolver.h"
+#include "TypeChecker.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace std::string_literals;
+
+TEST(TypeChecker, InfersAndReportsMismatches) {
+  auto lexer = Lexer{"x: Float -> 1;\n"
+                     "s: String -> \"a\" + \"b\";\n"
+                     "print x * 2 < 3;\n"
+                     "print s + x;\n"
+                     "{ b: Bool -> !s; b -> 1; }\n"
+                     "x -> -s;\n"
+                     "{ t: String -> s; print t = x; }\n"
+                     "print s - 1;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  Resolver{program}.run();
+  testing::internal::CaptureStderr();
+  auto checker = TypeChecker{program};
+  checker.run();
+  testing::internal::GetCapturedStderr();
+  // s + x, b -> 1, -s and s - 1
+  EXPECT_EQ(checker.getErrorCount(), 4);
+
+  auto *s = static_cast<VariableDeclaration *>(program.Statements[1]);
+  EXPECT_EQ(s->AssignedValue->Type, StaticType::String);
+  // x -> -s stores something that isn't a Float, so reads of x aren't either
+  auto *compare = static_cast<BinaryOperation *>(
+      static_cast<PrintStatement *>(program.Statements[2])->Expr);
+  EXPECT_EQ(compare->Type, StaticType::Unknown);
+  EXPECT_EQ(compare->Left->Type, StaticType::Unknown);
+  EXPECT_EQ(static_cast<BinaryOperation *>(compare->Left)->Right->Type,
+            StaticType::Float);
+  auto *mixed = static_cast<PrintStatement *>(program.Statements[3])->Expr;
+  EXPECT_EQ(mixed->Type, StaticType::Unknown);
+}
+
+TEST(TypeChecker, RedeclaredGlobalsAreUnknown) {
+  auto lexer = Lexer{"g: Float -> 1;\n"
+                     "g: String -> \"now a string\";\n"
+                     "print g + 1;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  Resolver{program}.run();
+  auto checker = TypeChecker{program};
+  checker.run();
+  EXPECT_EQ(checker.getErrorCount(), 0);
+  auto *sum = static_cast<PrintStatement *>(program.Statements[2])->Expr;
+  EXPECT_EQ(sum->Type, StaticType::Unknown);
+}
+
+TEST(TypeChecker, TypesNeedEveryStoreProven) {
+  auto lexer = Lexer{"g: Float -> 1;\n"
+                     "g: String -> \"g\";\n"
+                     "c: Float -> 1; b: Float -> 1; a: Float -> 1;\n"
+                     "z: Float -> 2;\n"
+                     "while c < 3 { b -> a; a -> c; c -> g; z -> z * 3; }\n"
+                     "print b + 1;\n"
+                     "print z / 2;\n"
+                     "print \"a\" < \"b\";\n"
+                     "print \"a\" < 1;\n"s,
+                     "tests.vrtx"};
+  auto parser = Parser{lexer};
+  auto &program = parser.parse();
+  Resolver{program}.run();
+  testing::internal::CaptureStderr();
+  auto checker = TypeChecker{program};
+  checker.run();
+  testing::internal::GetCapturedStderr();
+  // only "a" < 1, storing an unknown g in a Float isn't an error
+  EXPECT_EQ(checker.getErrorCount(), 1);
+  auto type = [&](std::size_t statement) {
+    return static_cast<PrintStatement *>(program.Statements[statement])
+        ->Expr->Type;
+  };
+  // c gets g, then a gets c, then b gets a
+  EXPECT_EQ(type(7), StaticType::Unknown);
+  EXPECT_EQ(type(8), StaticType::Float);
+  EXPECT_EQ(type(9), StaticType::Bool);
+  EXPECT_EQ(type(10), StaticType::Unknown);
+}